@@ -12,7 +12,7 @@ char *sys_dynlib_open(sys_dynlib_t *lib, const char *path)
 {
 	*lib = sys_dynlib_tryopen(path);
 	if(*lib == NULL)
-		return mprintf("Cannot open dynamic library '%s'. %s.", dlerror());
+		return mprintf("Cannot open dynamic library '%s'. %s.", path, dlerror());
 
 	return NULL;
 }
@@ -2,6 +2,8 @@
 #include <spawn.h>
 #include <sys/wait.h>
 
+extern char **environ;
+
 
 /**
  * Spawn a thread.
@@ -12,8 +14,11 @@
  */
 char *sys_spawn(sys_pid_t *pid, const char *path, char *const *argv)
 {
-	if(posix_spawn(pid, path, NULL, NULL, argv, NULL) < 0)
-		return mprintf("Failed to spawn process executing '%s'. %s.", path, strerror(errno));
+	int err;
+
+	err = posix_spawn(pid, path, NULL, NULL, argv, environ);
+	if(err != 0)
+		return mprintf("Failed to spawn process executing '%s'. %s.", path, strerror(err));
 
 	return NULL;
 }
@@ -21,13 +26,14 @@ char *sys_spawn(sys_pid_t *pid, const char *path, char *const *argv)
 /**
  * Wait on a process.
  *   @pid: The process ID.
- *   &returns: The status code.
+ *   &returns: The exit status, or negative if terminated abnormally.
  */
 int sys_wait(sys_pid_t pid)
 {
 	int status;
 
-	waitpid(pid, &status, 0);
+	if(waitpid(pid, &status, 0) < 0)
+		return -1;
 
-	return 0;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
@@ -1,10 +1,32 @@
 #include "common.h"
 
 
+/*
+ * Philox constants
+ */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+/*
+ * vector definitions
+ */
+#define LANES 4
+typedef uint64_t vec_t __attribute__((vector_size(LANES * sizeof(uint64_t))));
+
+/*
+ * local declarations
+ */
+static void rand_block(const uint32_t *key, const uint32_t *ctr, uint32_t *out);
+static void rand_lanes(const uint32_t *key, uint32_t *ctr, uint32_t *out);
+static void rand_inc(uint32_t *ctr, uint64_t n);
+
 /*
  * global variables
  */
-struct m_rand_t m_rand = { 123456789, 362436069, 521288629, 1049141 };
+struct m_rand_t m_rand = { { 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, 4 };
 
 
 /**
@@ -19,11 +41,45 @@ void m_rand_seed(uint32_t seed)
 /**
  * Initialize a random number generator.
  *   @seed: The seed.
- *   &returns; The random generator.
+ *   &returns: The random generator.
  */
 struct m_rand_t m_rand_init(uint32_t seed)
 {
-	return (struct m_rand_t){ 123456789, 362436069, 521288629, seed * 1049141 };
+	return m_rand_stream(seed, 0);
+}
+
+/**
+ * Initialize one of many independent streams of a random number
+ * generator. Each stream owns 2^64 blocks of the counter space, so
+ * streams of the same seed never overlap and are reproducible
+ * regardless of how many are in use.
+ *   @seed: The seed.
+ *   @stream: The stream index.
+ *   &returns: The random generator.
+ */
+struct m_rand_t m_rand_stream(uint64_t seed, uint64_t stream)
+{
+	return (struct m_rand_t){
+		{ (uint32_t)seed, (uint32_t)(seed >> 32) },
+		{ 0, 0, (uint32_t)stream, (uint32_t)(stream >> 32) },
+		{ 0, 0, 0, 0 },
+		4
+	};
+}
+
+/**
+ * Skip ahead a number of four-output blocks, discarding any outputs left
+ * in the current block.
+ *   @rand: The number generator.
+ *   @nblocks: The number of blocks.
+ */
+void m_rand_skip(struct m_rand_t *rand, uint64_t nblocks)
+{
+	if(rand == NULL)
+		rand = &m_rand;
+
+	rand_inc(rand->ctr, nblocks);
+	rand->idx = 4;
 }
 
 
@@ -34,18 +90,16 @@ struct m_rand_t m_rand_init(uint32_t seed)
  */
 uint32_t m_rand_u32(struct m_rand_t *rand)
 {
-	  uint32_t t;
-
-	  if(rand == NULL)
-		  rand = &m_rand;
+	if(rand == NULL)
+		rand = &m_rand;
 
-	  t = rand->x ^ (rand->x << 11);
-	  rand->x = rand->y;
-	  rand->y = rand->z;
-	  rand->z = rand->w;
-	  rand->w = rand->w ^ (rand->w >> 19) ^ (t ^ (t >> 8));
+	if(rand->idx >= 4) {
+		rand_block(rand->key, rand->ctr, rand->buf);
+		rand_inc(rand->ctr, 1);
+		rand->idx = 0;
+	}
 
-	  return rand->w;
+	return rand->buf[rand->idx++];
 }
 
 /**
@@ -55,7 +109,66 @@ uint32_t m_rand_u32(struct m_rand_t *rand)
  */
 uint64_t m_rand_u64(struct m_rand_t *rand)
 {
-	return ((uint64_t)m_rand_u32(rand) << 32) | (uint64_t)m_rand_u32(rand);
+	uint64_t hi;
+
+	if(rand == NULL)
+		rand = &m_rand;
+
+	if(rand->idx <= 2) {
+		hi = rand->buf[rand->idx];
+		rand->idx += 2;
+
+		return (hi << 32) | rand->buf[rand->idx - 1];
+	}
+
+	hi = m_rand_u32(rand);
+
+	return (hi << 32) | m_rand_u32(rand);
+}
+
+/**
+ * Compute an unbiased random integer less than a bound, using the
+ * multiply-shift method that only divides when a rejection is possible.
+ *   @rand: The number generator.
+ *   @n: The bound, must be nonzero.
+ *   &returns: The next number in `[0, n)`.
+ */
+uint32_t m_rand_bound(struct m_rand_t *rand, uint32_t n)
+{
+	uint32_t lim;
+	uint64_t m;
+
+	m = (uint64_t)m_rand_u32(rand) * n;
+	if((uint32_t)m < n) {
+		lim = -n % n;
+		while((uint32_t)m < lim)
+			m = (uint64_t)m_rand_u32(rand) * n;
+	}
+
+	return m >> 32;
+}
+
+/**
+ * Fill an array with random 32-bit unsigned integers. The output is
+ * identical to repeated calls to `m_rand_u32`, but whole blocks are
+ * computed several at a time in vector lanes.
+ *   @rand: The number generator.
+ *   @arr: The output array.
+ *   @n: The number of integers.
+ */
+void m_rand_fill(struct m_rand_t *rand, uint32_t *arr, size_t n)
+{
+	if(rand == NULL)
+		rand = &m_rand;
+
+	while((n > 0) && (rand->idx < 4))
+		*arr++ = rand->buf[rand->idx++], n--;
+
+	for(; n >= (4 * LANES); n -= 4 * LANES, arr += 4 * LANES)
+		rand_lanes(rand->key, rand->ctr, arr);
+
+	while(n-- > 0)
+		*arr++ = m_rand_u32(rand);
 }
 
 
@@ -66,5 +179,97 @@ uint64_t m_rand_u64(struct m_rand_t *rand)
  */
 double m_rand_d(struct m_rand_t *rand)
 {
-	return (double)(m_rand_u32(rand) & 0x3FFFFFFF) / (double)(0x40000000);
+	return (double)(m_rand_u64(rand) >> 11) * 0x1.0p-53;
+}
+
+
+/**
+ * Compute a single block of output.
+ *   @key: The key.
+ *   @ctr: The counter.
+ *   @out: Out. The four outputs.
+ */
+static void rand_block(const uint32_t *key, const uint32_t *ctr, uint32_t *out)
+{
+	unsigned int i;
+	uint32_t k0 = key[0], k1 = key[1], c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint64_t p0, p1;
+
+	for(i = 0; i < PHILOX_ROUNDS; i++) {
+		p0 = (uint64_t)PHILOX_M0 * c0;
+		p1 = (uint64_t)PHILOX_M1 * c2;
+
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+/**
+ * Compute consecutive blocks of output, one per vector lane, and advance
+ * the counter past them. Each 32-bit word is held in a 64-bit lane so
+ * the products stay exact.
+ *   @key: The key.
+ *   @ctr: Ref. The counter.
+ *   @out: Out. The `4 * LANES` outputs.
+ */
+static void rand_lanes(const uint32_t *key, uint32_t *ctr, uint32_t *out)
+{
+	unsigned int i;
+	uint64_t k0 = key[0], k1 = key[1];
+	vec_t c0, c1, c2, c3, p0, p1;
+
+	for(i = 0; i < LANES; i++) {
+		c0[i] = ctr[0];
+		c1[i] = ctr[1];
+		c2[i] = ctr[2];
+		c3[i] = ctr[3];
+		rand_inc(ctr, 1);
+	}
+
+	for(i = 0; i < PHILOX_ROUNDS; i++) {
+		p0 = c0 * PHILOX_M0;
+		p1 = c2 * PHILOX_M1;
+
+		c0 = (p1 >> 32) ^ c1 ^ k0;
+		c1 = p1 & 0xFFFFFFFFu;
+		c2 = (p0 >> 32) ^ c3 ^ k1;
+		c3 = p0 & 0xFFFFFFFFu;
+
+		k0 = (k0 + PHILOX_W0) & 0xFFFFFFFFu;
+		k1 = (k1 + PHILOX_W1) & 0xFFFFFFFFu;
+	}
+
+	for(i = 0; i < LANES; i++) {
+		out[4 * i + 0] = c0[i];
+		out[4 * i + 1] = c1[i];
+		out[4 * i + 2] = c2[i];
+		out[4 * i + 3] = c3[i];
+	}
+}
+
+/**
+ * Advance a 128-bit counter.
+ *   @ctr: Ref. The counter.
+ *   @n: The amount.
+ */
+static void rand_inc(uint32_t *ctr, uint64_t n)
+{
+	unsigned int i;
+	uint64_t sum;
+
+	for(i = 0; (i < 4) && (n > 0); i++) {
+		sum = (uint64_t)ctr[i] + (n & 0xFFFFFFFFu);
+		ctr[i] = (uint32_t)sum;
+		n = (n >> 32) + (sum >> 32);
+	}
 }
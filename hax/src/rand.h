@@ -2,11 +2,19 @@
 #define RAND_H
 
 /**
- * Random storage structure.
- *   @x, y, z, w: Storage data.
+ * Random storage structure, a Philox4x32-10 counter-based generator.
+ * Every 128-bit counter value maps to an independent block of four
+ * outputs under the key, so streams are split by counter range.
+ *   @key: The key.
+ *   @ctr: The next counter.
+ *   @buf: The current output block.
+ *   @idx: The index of the next buffered output, four when empty.
  */
 struct m_rand_t {
-	uint32_t x, y, z, w;
+	uint32_t key[2];
+	uint32_t ctr[4];
+	uint32_t buf[4];
+	uint32_t idx;
 };
 
 /*
@@ -16,9 +24,13 @@ extern struct m_rand_t m_rand;
 
 void m_rand_seed(uint32_t seed);
 struct m_rand_t m_rand_init(uint32_t seed);
+struct m_rand_t m_rand_stream(uint64_t seed, uint64_t stream);
+void m_rand_skip(struct m_rand_t *rand, uint64_t nblocks);
 
 uint32_t m_rand_u32(struct m_rand_t *rand);
 uint64_t m_rand_u64(struct m_rand_t *rand);
+uint32_t m_rand_bound(struct m_rand_t *rand, uint32_t n);
+void m_rand_fill(struct m_rand_t *rand, uint32_t *arr, size_t n);
 
 double m_rand_d(struct m_rand_t *rand);
 
@@ -0,0 +1,111 @@
+#include "../common.h"
+
+
+/*
+ * local declarations
+ */
+static inline uint64_t bloom_step(uint64_t hash);
+
+
+/**
+ * Initialize a Bloom filter sized for an expected number of insertions.
+ * With k probes, the filter uses about 1.5k bits per insertion, giving a
+ * false positive rate of about 2^-k at the expected size. The bit count
+ * is rounded up to a power of two.
+ *   @n: The expected number of insertions.
+ *   @k: The number of probes.
+ *   &returns: The filter.
+ */
+struct bloom_t bloom_init(size_t n, unsigned int k)
+{
+	size_t nbits = 64;
+	struct bloom_t bloom;
+
+	if(k == 0)
+		k = 1;
+
+	while(nbits < (n * k + n * k / 2))
+		nbits *= 2;
+
+	bloom.mask = nbits - 1;
+	bloom.k = k;
+	bloom.count = 0;
+	bloom.bits = malloc(nbits / 8);
+	memset(bloom.bits, 0x00, nbits / 8);
+
+	return bloom;
+}
+
+/**
+ * Destroy a Bloom filter.
+ *   @bloom: The filter.
+ */
+void bloom_destroy(struct bloom_t *bloom)
+{
+	free(bloom->bits);
+}
+
+
+/**
+ * Clear a Bloom filter.
+ *   @bloom: The filter.
+ */
+void bloom_clear(struct bloom_t *bloom)
+{
+	memset(bloom->bits, 0x00, (bloom->mask + 1) / 8);
+	bloom->count = 0;
+}
+
+/**
+ * Insert a hash into a Bloom filter.
+ *   @bloom: The filter.
+ *   @hash: The hash.
+ */
+void bloom_insert(struct bloom_t *bloom, uint64_t hash)
+{
+	unsigned int i;
+	uint64_t idx, step;
+
+	step = bloom_step(hash);
+
+	for(i = 0, idx = hash; i < bloom->k; i++, idx += step)
+		bloom->bits[(idx & bloom->mask) / 64] |= (uint64_t)1 << (idx % 64);
+
+	bloom->count++;
+}
+
+/**
+ * Query a Bloom filter for a hash.
+ *   @bloom: The filter.
+ *   @hash: The hash.
+ *   &returns: True if possibly inserted, false if definitely not.
+ */
+bool bloom_query(const struct bloom_t *bloom, uint64_t hash)
+{
+	unsigned int i;
+	uint64_t idx, step;
+
+	step = bloom_step(hash);
+
+	for(i = 0, idx = hash; i < bloom->k; i++, idx += step) {
+		if(!(bloom->bits[(idx & bloom->mask) / 64] & ((uint64_t)1 << (idx % 64))))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Derive the odd probe step of a hash, so the probes are spread by double
+ * hashing from a single hash.
+ *   @hash: The hash.
+ *   &returns: The step.
+ */
+static inline uint64_t bloom_step(uint64_t hash)
+{
+	hash = (hash >> 32) | (hash << 32);
+	hash *= 0x9E3779B97F4A7C15ul;
+
+	return (hash ^ (hash >> 29)) | 1;
+}
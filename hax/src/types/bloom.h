@@ -0,0 +1,28 @@
+#ifndef TYPES_BLOOM_H
+#define TYPES_BLOOM_H
+
+/**
+ * Bloom filter structure.
+ *   @bits: The bit array.
+ *   @mask: The bit index mask.
+ *   @k: The number of probes.
+ *   @count: The number of insertions.
+ */
+struct bloom_t {
+	uint64_t *bits;
+	size_t mask;
+	unsigned int k;
+	size_t count;
+};
+
+/*
+ * bloom filter declarations
+ */
+struct bloom_t bloom_init(size_t n, unsigned int k);
+void bloom_destroy(struct bloom_t *bloom);
+
+void bloom_clear(struct bloom_t *bloom);
+void bloom_insert(struct bloom_t *bloom, uint64_t hash);
+bool bloom_query(const struct bloom_t *bloom, uint64_t hash);
+
+#endif
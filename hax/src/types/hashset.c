@@ -0,0 +1,159 @@
+#include "../common.h"
+
+
+/*
+ * local declarations
+ */
+static void set_grow(struct hashset_t *set);
+
+
+/**
+ * Initialize a hash set.
+ *   @compare: The comparison callback.
+ *   @delete: The deletion callback.
+ *   &returns: The set.
+ */
+struct hashset_t hashset_init(compare_f compare, delete_f delete)
+{
+	struct hashset_t set;
+
+	set.mask = 15;
+	set.count = 0;
+	set.ent = malloc((set.mask + 1) * sizeof(struct hashset_ent_t));
+	set.compare = compare;
+	set.delete = delete;
+	memset(set.ent, 0x00, (set.mask + 1) * sizeof(struct hashset_ent_t));
+
+	return set;
+}
+
+/**
+ * Destroy a hash set.
+ *   @set: The set.
+ */
+void hashset_destroy(struct hashset_t *set)
+{
+	size_t i;
+
+	for(i = 0; i <= set->mask; i++) {
+		if(set->ent[i].ref != NULL)
+			set->delete(set->ent[i].ref);
+	}
+
+	free(set->ent);
+}
+
+
+/**
+ * Lookup a reference in the set.
+ *   @set: The set.
+ *   @hash: The hash.
+ *   @ref: The reference to search for.
+ *   &returns: The equal reference in the set or null.
+ */
+void *hashset_lookup(struct hashset_t *set, uint64_t hash, const void *ref)
+{
+	size_t i;
+	struct hashset_ent_t *ent;
+
+	for(i = hash & set->mask; ; i = (i + 1) & set->mask) {
+		ent = &set->ent[i];
+		if(ent->ref == NULL)
+			return NULL;
+		else if((ent->hash == hash) && (set->compare(ent->ref, ref) == 0))
+			return ent->ref;
+	}
+}
+
+/**
+ * Insert a reference into the set unless an equal reference is present.
+ *   @set: The set.
+ *   @hash: The hash.
+ *   @ref: The reference.
+ *   &returns: The equal reference already in the set, or null if inserted.
+ */
+void *hashset_insert(struct hashset_t *set, uint64_t hash, void *ref)
+{
+	size_t i;
+	struct hashset_ent_t *ent;
+
+	if(2 * (set->count + 1) > (set->mask + 1))
+		set_grow(set);
+
+	for(i = hash & set->mask; ; i = (i + 1) & set->mask) {
+		ent = &set->ent[i];
+		if(ent->ref == NULL)
+			break;
+		else if((ent->hash == hash) && (set->compare(ent->ref, ref) == 0))
+			return ent->ref;
+	}
+
+	ent->hash = hash;
+	ent->ref = ref;
+	set->count++;
+
+	return NULL;
+}
+
+/**
+ * Remove a reference from the set.
+ *   @set: The set.
+ *   @hash: The hash.
+ *   @ref: The reference to search for.
+ *   &returns: The removed reference or null.
+ */
+void *hashset_remove(struct hashset_t *set, uint64_t hash, const void *ref)
+{
+	void *found;
+	size_t i, j, home;
+
+	for(i = hash & set->mask; ; i = (i + 1) & set->mask) {
+		if(set->ent[i].ref == NULL)
+			return NULL;
+		else if((set->ent[i].hash == hash) && (set->compare(set->ent[i].ref, ref) == 0))
+			break;
+	}
+
+	found = set->ent[i].ref;
+	set->count--;
+
+	for(j = (i + 1) & set->mask; set->ent[j].ref != NULL; j = (j + 1) & set->mask) {
+		home = set->ent[j].hash & set->mask;
+		if(((j - home) & set->mask) < ((j - i) & set->mask))
+			continue;
+
+		set->ent[i] = set->ent[j];
+		i = j;
+	}
+
+	set->ent[i].ref = NULL;
+
+	return found;
+}
+
+
+/**
+ * Double the capacity of a set.
+ *   @set: The set.
+ */
+static void set_grow(struct hashset_t *set)
+{
+	size_t i, j, mask;
+	struct hashset_ent_t *ent;
+
+	mask = 2 * set->mask + 1;
+	ent = malloc((mask + 1) * sizeof(struct hashset_ent_t));
+	memset(ent, 0x00, (mask + 1) * sizeof(struct hashset_ent_t));
+
+	for(i = 0; i <= set->mask; i++) {
+		if(set->ent[i].ref == NULL)
+			continue;
+
+		for(j = set->ent[i].hash & mask; ent[j].ref != NULL; j = (j + 1) & mask);
+		ent[j] = set->ent[i];
+	}
+
+	free(set->ent);
+	set->ent = ent;
+	set->mask = mask;
+}
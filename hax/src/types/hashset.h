@@ -0,0 +1,40 @@
+#ifndef TYPES_HASHSET_H
+#define TYPES_HASHSET_H
+
+/**
+ * Hash set entry structure.
+ *   @hash: The hash.
+ *   @ref: The reference, null if empty.
+ */
+struct hashset_ent_t {
+	uint64_t hash;
+	void *ref;
+};
+
+/**
+ * Open-addressing hash set.
+ *   @ent: The entry array.
+ *   @mask: The capacity mask.
+ *   @count: The number of entries.
+ *   @compare: The comparison callback, only used on equal hashes.
+ *   @delete: The deletion callback.
+ */
+struct hashset_t {
+	struct hashset_ent_t *ent;
+	size_t mask, count;
+
+	compare_f compare;
+	delete_f delete;
+};
+
+/*
+ * hash set declarations
+ */
+struct hashset_t hashset_init(compare_f compare, delete_f delete);
+void hashset_destroy(struct hashset_t *set);
+
+void *hashset_lookup(struct hashset_t *set, uint64_t hash, const void *ref);
+void *hashset_insert(struct hashset_t *set, uint64_t hash, void *ref);
+void *hashset_remove(struct hashset_t *set, uint64_t hash, const void *ref);
+
+#endif
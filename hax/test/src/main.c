@@ -5,8 +5,11 @@
  * test declarations
  */
 bool test_printf(void);
+bool test_rand(void);
 
 bool test_avltree(void);
+bool test_bloom(void);
+bool test_hashset(void);
 bool test_strtrie(void);
 
 bool test_sys_notify(void);
@@ -32,8 +35,11 @@ int main(int argc, char **argv)
 	setlocale(LC_CTYPE, "");
 
 	suc &= test_printf();
+	suc &= test_rand();
 
 	suc &= test_avltree();
+	suc &= test_bloom();
+	suc &= test_hashset();
 	suc &= test_strtrie();
 
 	suc &= test_sys_thread();
@@ -0,0 +1,90 @@
+#include "common.h"
+
+
+/**
+ * Perform tests on the random number generator.
+ *   &returns: Success flag.
+ */
+bool test_rand(void)
+{
+	bool suc = true;
+
+	{
+		uint32_t out[4];
+		uint64_t wide;
+		struct m_rand_t rand;
+
+		/* known answers of Philox4x32-10 */
+		rand = m_rand_stream(0, 0);
+		out[0] = m_rand_u32(&rand);
+		out[1] = m_rand_u32(&rand);
+		wide = m_rand_u64(&rand);
+		suc &= chk(out[0] == 0x6627e8d5, "rand0");
+		suc &= chk(out[1] == 0xe169c58d, "rand1");
+		suc &= chk(wide == 0xbc57ac4c9b00dbd8ul, "rand2");
+
+		rand = m_rand_stream(0xFFFFFFFFFFFFFFFFul, 0xFFFFFFFFFFFFFFFFul);
+		m_rand_skip(&rand, 0xFFFFFFFFFFFFFFFFul);
+		m_rand_fill(&rand, out, 4);
+		suc &= chk(out[0] == 0x408f276d, "rand3");
+		suc &= chk(out[1] == 0x41c83b0e, "rand4");
+		suc &= chk(out[2] == 0xa20bc7c6, "rand5");
+		suc &= chk(out[3] == 0x6d5451fd, "rand6");
+	}
+
+	{
+		unsigned int i, nbad = 0;
+		uint32_t arr[103], out[2];
+		struct m_rand_t fill, ref;
+
+		fill = ref = m_rand_stream(17, 3);
+		m_rand_u32(&fill);
+		m_rand_u32(&ref);
+		m_rand_fill(&fill, arr, 103);
+
+		for(i = 0; i < 103; i++)
+			nbad += (arr[i] != m_rand_u32(&ref));
+
+		suc &= chk(nbad == 0, "rand7");
+
+		out[0] = m_rand_u32(&fill);
+		out[1] = m_rand_u32(&ref);
+		suc &= chk(out[0] == out[1], "rand8");
+
+		fill = m_rand_stream(17, 3);
+		ref = m_rand_stream(17, 3);
+		m_rand_skip(&fill, 5);
+		for(i = 0; i < 20; i++)
+			m_rand_u32(&ref);
+
+		out[0] = m_rand_u32(&fill);
+		out[1] = m_rand_u32(&ref);
+		suc &= chk(out[0] == out[1], "rand9");
+	}
+
+	{
+		double flt;
+		unsigned int i, nbad = 0, cnt[7] = { 0 };
+		struct m_rand_t rand = m_rand_stream(1, 0);
+
+		for(i = 0; i < 70000; i++)
+			cnt[m_rand_bound(&rand, 7)]++;
+
+		for(i = 0; i < 7; i++)
+			suc &= chk((cnt[i] > 9500) && (cnt[i] < 10500), "rand10");
+
+		for(i = 0; i < 1000; i++)
+			nbad += (m_rand_bound(&rand, 0x80000001u) >= 0x80000001u);
+
+		suc &= chk(nbad == 0, "rand11");
+
+		for(i = 0; i < 1000; i++) {
+			flt = m_rand_d(&rand);
+			nbad += (flt < 0.0) || (flt >= 1.0);
+		}
+
+		suc &= chk(nbad == 0, "rand12");
+	}
+
+	return suc;
+}
@@ -0,0 +1,49 @@
+#include "../common.h"
+
+
+/**
+ * Perform tests on the Bloom filter implementation.
+ *   &returns: Success flag.
+ */
+bool test_bloom(void)
+{
+	bool suc = true;
+
+	{
+		uint64_t i;
+		unsigned int nfalse = 0;
+		struct bloom_t bloom;
+
+		bloom = bloom_init(10000, 7);
+
+		for(i = 0; i < 10000; i++)
+			bloom_insert(&bloom, i * 0x9E3779B97F4A7C15ul);
+
+		for(i = 0; i < 10000; i++)
+			suc &= chk(bloom_query(&bloom, i * 0x9E3779B97F4A7C15ul), "bloom0");
+
+		for(i = 10000; i < 110000; i++)
+			nfalse += bloom_query(&bloom, i * 0x9E3779B97F4A7C15ul);
+
+		suc &= chk(nfalse < 2000, "bloom1");
+		suc &= chk(bloom.count == 10000, "bloom2");
+
+		bloom_clear(&bloom);
+
+		for(i = 0; i < 10000; i++)
+			suc &= chk(!bloom_query(&bloom, i * 0x9E3779B97F4A7C15ul), "bloom3");
+
+		bloom_destroy(&bloom);
+	}
+
+	{
+		struct bloom_t bloom;
+
+		bloom = bloom_init(0, 0);
+		bloom_insert(&bloom, 42);
+		suc &= chk(bloom_query(&bloom, 42), "bloom4");
+		bloom_destroy(&bloom);
+	}
+
+	return suc;
+}
@@ -0,0 +1,81 @@
+#include "../common.h"
+
+
+/**
+ * Compare two integers by value.
+ *   @left: The left integer.
+ *   @right: The right integer.
+ *   &returns: Their order.
+ */
+static int int_cmp(const void *left, const void *right)
+{
+	return *(const int *)left - *(const int *)right;
+}
+
+/**
+ * Perform tests on the hash set implementation.
+ *   &returns: Success flag.
+ */
+bool test_hashset(void)
+{
+	bool suc = true;
+
+	{
+		int i, val[1000];
+		void *ref;
+		struct hashset_t set;
+
+		set = hashset_init(int_cmp, delete_noop);
+
+		for(i = 0; i < 1000; i++)
+			val[i] = i;
+
+		/* every value shares one of four hashes to force collisions */
+		for(i = 0; i < 1000; i++) {
+			ref = hashset_insert(&set, i % 4, &val[i]);
+			suc &= chk(ref == NULL, "hashset0");
+		}
+
+		for(i = 0; i < 1000; i++) {
+			ref = hashset_insert(&set, i % 4, &(int){ i });
+			suc &= chk(ref == &val[i], "hashset1");
+		}
+
+		suc &= chk(set.count == 1000, "hashset2");
+
+		for(i = 0; i < 1000; i += 2) {
+			ref = hashset_remove(&set, i % 4, &(int){ i });
+			suc &= chk(ref == &val[i], "hashset3");
+		}
+
+		for(i = 0; i < 1000; i++)
+			suc &= chk(hashset_lookup(&set, i % 4, &(int){ i }) == ((i % 2) ? &val[i] : NULL), "hashset4");
+
+		suc &= chk(hashset_lookup(&set, 1, &(int){ 2000 }) == NULL, "hashset5");
+		suc &= chk(set.count == 500, "hashset6");
+
+		hashset_destroy(&set);
+	}
+
+	{
+		int i, val[5000];
+		struct hashset_t set;
+
+		set = hashset_init(int_cmp, delete_noop);
+
+		for(i = 0; i < 5000; i++) {
+			val[i] = i;
+			hashset_insert(&set, (uint64_t)i * 0x9E3779B97F4A7C15ul, &val[i]);
+		}
+
+		for(i = 0; i < 5000; i += 3)
+			hashset_remove(&set, (uint64_t)i * 0x9E3779B97F4A7C15ul, &val[i]);
+
+		for(i = 0; i < 5000; i++)
+			suc &= chk(hashset_lookup(&set, (uint64_t)i * 0x9E3779B97F4A7C15ul, &val[i]) == ((i % 3) ? &val[i] : NULL), "hashset7");
+
+		hashset_destroy(&set);
+	}
+
+	return suc;
+}
@@ -1,6 +1,19 @@
 #include "../common.h"
 
 
+/*
+ * local declarations
+ */
+static bool mat_elim(struct r_expr_t **arr, unsigned int n, unsigned int w, unsigned int top, bool *neg);
+static bool mat_pivot(const struct r_expr_t *ent, const struct r_expr_t *best);
+static struct r_expr_t *mat_step(struct r_expr_t *piv, struct r_expr_t *ent, struct r_expr_t *lead, struct r_expr_t *top, struct r_expr_t *prev);
+
+static bool sparse_pivot(struct r_grad_t **row, const bool *used, const bool *elim, const bool *want, bool phase, unsigned int n, unsigned int *prow, unsigned int *pcol);
+static struct r_grad_t *sparse_elim(struct r_grad_t *row, struct r_expr_t *fac, const struct r_grad_t *piv, unsigned int col);
+static struct r_grad_t *sparse_copy(const struct r_grad_t *row);
+static struct r_expr_t *sparse_find(const struct r_grad_t *row, unsigned int col);
+
+
 /**
  * Create an expression matrix.
  *   @width; The width.
@@ -113,49 +126,43 @@ struct r_expr_t *rmat_expr_det(struct rmat_expr_t *mat)
 	assert(mat->width == mat->height);
 
 	unsigned int i;
-	struct r_list_t *list;
-	struct r_expr_t *sel, *expr;
 	struct rmat_expr_t *tmp;
 
-	if(mat->width == 1)
-		return r_expr_copy(mat->arr[0]);
-
-	list = r_list_new();
-
-	for(i = 0; i < mat->width; i++) {
-		sel = *rmat_expr_get(mat, 0, i);
-		if(r_expr_is_zero(sel))
-			continue;
-
-		tmp = rmat_expr_exclude(mat, 0, i);
-		expr = rmat_expr_det(tmp);
-		rmat_expr_delete(tmp);
+	tmp = malloc(sizeof(struct rmat_expr_t));
+	tmp->width = mat->width;
+	tmp->height = mat->height;
+	tmp->arr = malloc(mat->width * mat->height * sizeof(void *));
 
-		if(!r_expr_is_one(sel))
-			expr = r_expr_mul(r_expr_copy(sel), expr);
-
-		if((i % 2) == 1)
-			expr = r_expr_neg(expr);
-
-		r_list_add(&list, expr);
-	}
-
-	if(list == NULL)
-		r_list_add(&list, r_expr_zero());
+	for(i = 0; i < (mat->width * mat->height); i++)
+		tmp->arr[i] = r_expr_copy(mat->arr[i]);
 
-	return r_expr_sum(list);
+	return rmat_expr_det_clr(tmp);
 }
 
 /**
  * Compute the determinant of an expression matrix, clearing the input.
+ * The determinant is the final pivot of fraction-free elimination.
  *   @mat: Consumed. The expression matrix.
  *   &returns: The determinant expression.
  */
 struct r_expr_t *rmat_expr_det_clr(struct rmat_expr_t *mat)
 {
+	assert(mat->width == mat->height);
+
+	bool neg = false;
+	unsigned int n = mat->width;
 	struct r_expr_t *res;
 
-	res = rmat_expr_det(mat);
+	if(mat_elim(mat->arr, n, n, n, &neg)) {
+		res = mat->arr[(n - 1) * n + (n - 1)];
+		mat->arr[(n - 1) * n + (n - 1)] = r_expr_zero();
+
+		if(neg)
+			res = r_fold_expr_clr(r_expr_neg(res));
+	}
+	else
+		res = r_expr_zero();
+
 	rmat_expr_delete(mat);
 
 	return res;
@@ -163,7 +170,9 @@ struct r_expr_t *rmat_expr_det_clr(struct rmat_expr_t *mat)
 
 
 /**
- * Compute the inverse of a matrix.
+ * Compute the inverse of a matrix. The matrix is augmented with the
+ * identity and reduced by fraction-free Gauss-Jordan elimination, leaving
+ * the determinant on the diagonal and the adjugate on the right.
  *   @mat: The matrix.
  *   &returns: The inverse.
  */
@@ -171,30 +180,134 @@ struct rmat_expr_t *rmat_expr_inv(struct rmat_expr_t *mat)
 {
 	assert(mat->width == mat->height);
 
-	struct r_expr_t *det, *co;
+	bool neg = false;
+	unsigned int i, j, n = mat->width, w = 2 * mat->width;
+	struct r_expr_t *arr[n * w], *det;
 	struct rmat_expr_t *inv;
-	unsigned int i, j;
 
-	det = rmat_expr_det(mat);
-	inv = rmat_expr_new(mat->width, mat->height);
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++) {
+			arr[i * w + j] = r_expr_copy(*rmat_expr_get(mat, i, j));
+			arr[i * w + n + j] = (i == j) ? r_expr_one() : r_expr_zero();
+		}
+	}
 
-	for(j = 0; j < mat->width; j++) {
-		for(i = 0; i < mat->height; i++) {
-			co = r_expr_div(rmat_expr_det_clr(rmat_expr_exclude(mat, j, i)), r_expr_copy(det));
+	if(!mat_elim(arr, n, w, 0, &neg))
+		fatal("Cannot invert a singular matrix.");
 
-			if(((i + j) % 2) == 1)
-				co = r_expr_neg(co);
+	det = arr[(n - 1) * w + (n - 1)];
+	inv = rmat_expr_new(n, n);
 
-			r_expr_set(rmat_expr_get(inv, i, j), co);
-		}
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++)
+			r_expr_set(rmat_expr_get(inv, i, j), r_fold_expr_clr(r_expr_div(arr[i * w + n + j], r_expr_copy(det))));
 	}
 
-	r_expr_delete(det);
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++)
+			r_expr_delete(arr[i * w + j]);
+	}
 
 	return inv;
 }
 
 
+/**
+ * Solve a linear system for a subset of its unknowns. The wanted unknowns
+ * are ordered last and the system augmented with the right-hand side is
+ * reduced by fraction-free elimination, back substituting only among the
+ * wanted unknowns. No column of the inverse is formed.
+ *   @mat: The coefficient matrix.
+ *   @vec: The right-hand side.
+ *   @idx: Optional. The distinct indices of the wanted unknowns, or null
+ *     for all unknowns.
+ *   @cnt: The number of wanted unknowns, ignored if `idx` is null.
+ *   &returns: The solution of each wanted unknown, in order.
+ */
+struct rvec_expr_t *rmat_expr_solve(struct rmat_expr_t *mat, struct rvec_expr_t *vec, const unsigned int *idx, unsigned int cnt)
+{
+	assert((mat->width == mat->height) && (mat->height == vec->len));
+
+	bool neg = false, want[mat->width];
+	unsigned int i, j, n = mat->width, w = mat->width + 1, col[mat->width];
+	struct r_expr_t *arr[n * w], *det;
+	struct rvec_expr_t *res;
+
+	if(idx == NULL)
+		cnt = n;
+
+	for(j = 0; j < n; j++)
+		want[j] = false;
+
+	for(i = 0; i < cnt; i++) {
+		assert((idx == NULL) || ((idx[i] < n) && !want[idx[i]]));
+		want[(idx != NULL) ? idx[i] : i] = true;
+	}
+
+	for(i = j = 0; j < n; j++) {
+		if(!want[j])
+			col[i++] = j;
+	}
+
+	for(j = 0; j < cnt; j++)
+		col[i++] = (idx != NULL) ? idx[j] : j;
+
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++)
+			arr[i * w + j] = r_expr_copy(*rmat_expr_get(mat, i, col[j]));
+
+		arr[i * w + n] = r_expr_copy(vec->arr[i]);
+	}
+
+	if(!mat_elim(arr, n, w, n - cnt, &neg))
+		fatal("Cannot solve a singular system.");
+
+	det = arr[(n - 1) * w + (n - 1)];
+	res = rvec_expr_new(cnt);
+
+	for(j = 0; j < cnt; j++) {
+		i = n - cnt + j;
+		r_expr_set(&res->arr[j], r_fold_expr_clr(r_expr_div(arr[i * w + n], r_expr_copy(det))));
+		arr[i * w + n] = NULL;
+	}
+
+	for(i = 0; i < (n * w); i++) {
+		if(arr[i] != NULL)
+			r_expr_delete(arr[i]);
+	}
+
+	return res;
+}
+
+
+/**
+ * Compute the Jacobian of the left-hand sides of a system of equations.
+ * The gradients of all relations are taken in one memoized pass.
+ *   @sys: The system.
+ *   @var: The variables.
+ *   &returns: The matrix with a row per relation and a column per variable.
+ */
+struct rmat_expr_t *rmat_expr_jacob(struct r_sys_t *sys, struct rvec_var_t *var)
+{
+	unsigned int i;
+	struct r_diff_t *diff;
+	struct rmat_expr_t *mat;
+	const struct r_grad_t *grad;
+
+	diff = r_diff_new(var);
+	mat = rmat_expr_new(var->len, r_sys_cnt(sys));
+
+	for(i = 0; sys != NULL; sys = sys->next, i++) {
+		for(grad = r_diff_grad(diff, sys->rel->left); grad != NULL; grad = grad->next)
+			r_expr_set(rmat_expr_get(mat, i, grad->idx), r_expr_copy(grad->expr));
+	}
+
+	r_diff_delete(diff);
+
+	return mat;
+}
+
+
 /**
  * Create an expression matrix excluding a row and column.
  *   @mat: The matrix.
@@ -218,6 +331,193 @@ struct rmat_expr_t *rmat_expr_exclude(struct rmat_expr_t *mat, unsigned int row,
 }
 
 
+/**
+ * Create a sparse expression matrix with no entries.
+ *   @width; The width.
+ *   @height: The height.
+ *   &returns: The sparse matrix.
+ */
+struct rmat_sparse_t *rmat_sparse_new(unsigned int width, unsigned int height)
+{
+	unsigned int i;
+	struct rmat_sparse_t *mat;
+
+	mat = malloc(sizeof(struct rmat_sparse_t));
+	mat->width = width;
+	mat->height = height;
+	mat->row = malloc(height * sizeof(void *));
+
+	for(i = 0; i < height; i++)
+		mat->row[i] = NULL;
+
+	return mat;
+}
+
+/**
+ * Delete a sparse expression matrix.
+ *   @mat: The sparse matrix.
+ */
+void rmat_sparse_delete(struct rmat_sparse_t *mat)
+{
+	unsigned int i;
+
+	for(i = 0; i < mat->height; i++)
+		r_grad_delete(mat->row[i]);
+
+	free(mat->row);
+	free(mat);
+}
+
+
+/**
+ * Dump the nonzero entries of a sparse matrix to standard out.
+ *   @mat: The sparse matrix.
+ */
+void rmat_sparse_dump(struct rmat_sparse_t *mat)
+{
+	unsigned int i;
+	const struct r_grad_t *ent;
+
+	for(i = 0; i < mat->height; i++) {
+		for(ent = mat->row[i]; ent != NULL; ent = ent->next)
+			printf("%u:%C\t", ent->idx, r_expr_chunk(ent->expr));
+
+		printf("\n");
+	}
+}
+
+
+/**
+ * Extract the coefficient matrix and right-hand side of a normalized
+ * linear system. Each relation is walked once, producing only the nonzero
+ * coefficients of its row and the negated constant term.
+ *   @mat: Out. The sparse coefficient matrix.
+ *   @vec: Out. The right-hand side.
+ *   @sys: The system.
+ *   @var: The variables.
+ *   &returns: Error.
+ */
+char *rmat_sparse_sys(struct rmat_sparse_t **mat, struct rvec_expr_t **vec, struct r_sys_t *sys, struct rvec_var_t *var)
+{
+	char *err;
+	unsigned int i;
+	struct r_diff_t *diff;
+	struct r_expr_t *cst;
+
+	diff = r_diff_new(var);
+	*mat = rmat_sparse_new(var->len, r_sys_cnt(sys));
+	*vec = rvec_expr_new(r_sys_cnt(sys));
+
+	for(i = 0; sys != NULL; sys = sys->next, i++) {
+		err = r_diff_lin(diff, sys->rel->left, &(*mat)->row[i], &cst);
+		if(err != NULL) {
+			rmat_sparse_delete(*mat);
+			rvec_expr_delete(*vec);
+			r_diff_delete(diff);
+
+			return err;
+		}
+
+		r_expr_set(&(*vec)->arr[i], r_fold_expr_clr(r_expr_neg(cst)));
+	}
+
+	r_diff_delete(diff);
+
+	return NULL;
+}
+
+/**
+ * Solve a sparse system of linear equations for a subset of its unknowns.
+ * Gaussian elimination only touches the rows holding the pivot column, and
+ * each pivot is chosen to minimize the fill-in it may cause. The unwanted
+ * unknowns are eliminated first so that back substitution only involves
+ * the wanted ones.
+ *   @mat: The sparse coefficient matrix.
+ *   @vec: The right-hand side.
+ *   @idx: Optional. The indices of the wanted unknowns, all if null.
+ *   @cnt: The number of wanted unknowns.
+ *   &returns: The wanted unknowns, in the order requested.
+ */
+struct rvec_expr_t *rmat_sparse_solve(struct rmat_sparse_t *mat, struct rvec_expr_t *vec, const unsigned int *idx, unsigned int cnt)
+{
+	assert((mat->width == mat->height) && (mat->height == vec->len));
+
+	bool want[mat->width], used[mat->width], elim[mat->width];
+	unsigned int i, j, k, n = mat->width, r = 0, c = 0, ord[mat->width], piv[mat->width];
+	struct r_grad_t *row[mat->width];
+	const struct r_grad_t *ent;
+	struct r_expr_t *rhs[mat->width], *sol[mat->width], *lead, *fac;
+	struct rvec_expr_t *res;
+
+	if(idx == NULL)
+		cnt = n;
+
+	for(j = 0; j < n; j++)
+		want[j] = used[j] = elim[j] = false;
+
+	for(i = 0; i < cnt; i++) {
+		assert((idx == NULL) || ((idx[i] < n) && !want[idx[i]]));
+		want[(idx != NULL) ? idx[i] : i] = true;
+	}
+
+	for(i = 0; i < n; i++) {
+		row[i] = sparse_copy(mat->row[i]);
+		rhs[i] = r_expr_copy(vec->arr[i]);
+		sol[i] = NULL;
+	}
+
+	for(k = 0; k < n; k++) {
+		if(!sparse_pivot(row, used, elim, want, k >= (n - cnt), n, &r, &c))
+			fatal("Cannot solve a singular system.");
+
+		ord[k] = c;
+		piv[c] = r;
+		used[r] = elim[c] = true;
+		lead = sparse_find(row[r], c);
+
+		for(i = 0; i < n; i++) {
+			if(used[i] || (sparse_find(row[i], c) == NULL))
+				continue;
+
+			fac = r_fold_expr_clr(r_expr_div(r_expr_copy(sparse_find(row[i], c)), r_expr_copy(lead)));
+			row[i] = sparse_elim(row[i], r_expr_copy(fac), row[r], c);
+			rhs[i] = r_fold_expr_clr(r_expr_sub(rhs[i], r_expr_mul(fac, r_expr_copy(rhs[r]))));
+		}
+	}
+
+	for(k = n; k-- > (n - cnt); ) {
+		c = ord[k];
+		r = piv[c];
+		sol[c] = r_expr_copy(rhs[r]);
+
+		for(ent = row[r]; ent != NULL; ent = ent->next) {
+			if(ent->idx != c)
+				sol[c] = r_expr_sub(sol[c], r_expr_mul(r_expr_copy(ent->expr), r_expr_copy(sol[ent->idx])));
+		}
+
+		sol[c] = r_fold_expr_clr(r_expr_div(sol[c], r_expr_copy(sparse_find(row[r], c))));
+	}
+
+	res = rvec_expr_new(cnt);
+
+	for(j = 0; j < cnt; j++) {
+		c = (idx != NULL) ? idx[j] : j;
+		r_expr_set(&res->arr[j], sol[c]);
+		sol[c] = NULL;
+	}
+
+	for(i = 0; i < n; i++) {
+		r_grad_delete(row[i]);
+		r_expr_delete(rhs[i]);
+
+		if(sol[i] != NULL)
+			r_expr_delete(sol[i]);
+	}
+
+	return res;
+}
+
+
 /**
  * Create a float matrix.
  *   @w; The width.
@@ -246,3 +546,307 @@ void rmat_flt_delete(struct rmat_flt_t *mat)
 {
 	free(mat);
 }
+
+
+/**
+ * Choose the next pivot of a sparse elimination by the Markowitz count
+ * `(row nonzeros - 1) * (column nonzeros - 1)`, an upper bound on the
+ * fill-in, breaking ties toward the smaller expression. Float entries
+ * below `RMAT_PIVOT` times the largest float in their column are passed
+ * over, so a small pivot never amplifies the rounding error.
+ *   @row: The rows.
+ *   @used: The rows already used as pivots.
+ *   @elim: The columns already eliminated.
+ *   @want: The wanted columns.
+ *   @phase: Only pivot on wanted columns if set, otherwise unwanted.
+ *   @n: The number of rows and columns.
+ *   @prow: Out. The pivot row.
+ *   @pcol: Out. The pivot column.
+ *   &returns: True if a pivot was found, false if singular.
+ */
+static bool sparse_pivot(struct r_grad_t **row, const bool *used, const bool *elim, const bool *want, bool phase, unsigned int n, unsigned int *prow, unsigned int *pcol)
+{
+	bool found = false;
+	unsigned int i, rcnt, ccnt[n], cost, best = 0, size = 0;
+	double cmax[n];
+	const struct r_grad_t *ent;
+
+	for(i = 0; i < n; i++) {
+		ccnt[i] = 0;
+		cmax[i] = 0.0;
+	}
+
+	for(i = 0; i < n; i++) {
+		if(used[i])
+			continue;
+
+		for(ent = row[i]; ent != NULL; ent = ent->next) {
+			ccnt[ent->idx]++;
+			if(ent->expr->type == r_flt_v)
+				cmax[ent->idx] = fmax(cmax[ent->idx], fabs(ent->expr->data.flt));
+		}
+	}
+
+	for(i = 0; i < n; i++) {
+		if(used[i])
+			continue;
+
+		for(rcnt = 0, ent = row[i]; ent != NULL; ent = ent->next)
+			rcnt++;
+
+		for(ent = row[i]; ent != NULL; ent = ent->next) {
+			if(elim[ent->idx] || (want[ent->idx] != phase))
+				continue;
+
+			if((ent->expr->type == r_flt_v) && (fabs(ent->expr->data.flt) < (RMAT_PIVOT * cmax[ent->idx])))
+				continue;
+
+			cost = (rcnt - 1) * (ccnt[ent->idx] - 1);
+			if(!found || (cost < best) || ((cost == best) && (ent->expr->size < size))) {
+				found = true;
+				best = cost;
+				size = ent->expr->size;
+				*prow = i;
+				*pcol = ent->idx;
+			}
+		}
+	}
+
+	return found;
+}
+
+/**
+ * Subtract a multiple of the pivot row from a row, removing the pivot
+ * column and dropping any entries that fold to zero, or for floats, to
+ * within rounding error of zero.
+ *   @row: Consumed. The row.
+ *   @fac: Consumed. The factor.
+ *   @piv: The pivot row.
+ *   @col: The pivot column.
+ *   &returns: The updated row.
+ */
+static struct r_grad_t *sparse_elim(struct r_grad_t *row, struct r_expr_t *fac, const struct r_grad_t *piv, unsigned int col)
+{
+	double scale;
+	struct r_grad_t *res = NULL, **iter = &res, *ent;
+	struct r_expr_t *expr;
+
+	while((row != NULL) || (piv != NULL)) {
+		if((row != NULL) && (row->idx == col)) {
+			ent = row;
+			row = row->next;
+			r_expr_delete(ent->expr);
+			free(ent);
+		}
+		else if((piv != NULL) && (piv->idx == col))
+			piv = piv->next;
+		else if((piv == NULL) || ((row != NULL) && (row->idx < piv->idx))) {
+			*iter = row;
+			iter = &row->next;
+			row = row->next;
+		}
+		else {
+			if((row != NULL) && (row->idx == piv->idx)) {
+				ent = row;
+				row = row->next;
+				scale = NAN;
+				if((ent->expr->type == r_flt_v) && (fac->type == r_flt_v) && (piv->expr->type == r_flt_v))
+					scale = fabs(ent->expr->data.flt) + fabs(fac->data.flt * piv->expr->data.flt);
+
+				expr = r_fold_expr_clr(r_expr_sub(ent->expr, r_expr_mul(r_expr_copy(fac), r_expr_copy(piv->expr))));
+				if((expr->type == r_flt_v) && (fabs(expr->data.flt) <= (RMAT_TOL * scale)))
+					r_expr_replace(&expr, r_expr_zero());
+			}
+			else {
+				ent = malloc(sizeof(struct r_grad_t));
+				ent->idx = piv->idx;
+				expr = r_fold_expr_clr(r_expr_neg(r_expr_mul(r_expr_copy(fac), r_expr_copy(piv->expr))));
+			}
+
+			piv = piv->next;
+
+			if(r_expr_is_zero(expr)) {
+				r_expr_delete(expr);
+				free(ent);
+			}
+			else {
+				ent->expr = expr;
+				*iter = ent;
+				iter = &ent->next;
+			}
+		}
+	}
+
+	*iter = NULL;
+	r_expr_delete(fac);
+
+	return res;
+}
+
+/**
+ * Copy a sparse row.
+ *   @row: The row.
+ *   &returns: The copy.
+ */
+static struct r_grad_t *sparse_copy(const struct r_grad_t *row)
+{
+	struct r_grad_t *res = NULL, **iter = &res;
+
+	for(; row != NULL; row = row->next) {
+		*iter = malloc(sizeof(struct r_grad_t));
+		**iter = (struct r_grad_t){ row->idx, r_expr_copy(row->expr), NULL };
+		iter = &(*iter)->next;
+	}
+
+	return res;
+}
+
+/**
+ * Find an entry of a sparse row.
+ *   @row: The row.
+ *   @col: The column.
+ *   &returns: The entry or null if zero.
+ */
+static struct r_expr_t *sparse_find(const struct r_grad_t *row, unsigned int col)
+{
+	for(; (row != NULL) && (row->idx <= col); row = row->next) {
+		if(row->idx == col)
+			return row->expr;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Perform fraction-free (Bareiss) elimination over the leading square
+ * block of a row-major expression array. Each step replaces an entry with
+ * `(piv * ent - lead * top) / prev`, where `prev` is the previous pivot,
+ * so the entries stay polynomial in the inputs and only O(n^3) steps are
+ * taken. The pivot of each column is chosen by `mat_pivot`. On success,
+ * the last diagonal entry is the determinant, up to sign.
+ *   @arr: Ref. The expression array.
+ *   @n: The number of rows.
+ *   @w: The width, at least `n`.
+ *   @top: The first row eliminated above the pivots. Rows from `top`
+ *     onward are fully reduced, leaving their diagonal entries equal to
+ *     the last pivot; `n` performs only forward elimination.
+ *   @neg: Ref. Flipped on every row swap.
+ *   &returns: True if every column had a nonzero pivot.
+ */
+static bool mat_elim(struct r_expr_t **arr, unsigned int n, unsigned int w, unsigned int top, bool *neg)
+{
+	unsigned int i, j, k, p;
+	struct r_expr_t *piv, *lead, *prev = NULL;
+
+	for(k = 0; k < n; k++) {
+		p = n;
+
+		for(i = k; i < n; i++) {
+			if(r_expr_is_zero(arr[i * w + k]))
+				continue;
+
+			if((p == n) || mat_pivot(arr[i * w + k], arr[p * w + k]))
+				p = i;
+		}
+
+		if(p == n) {
+			if(prev != NULL)
+				r_expr_delete(prev);
+
+			return false;
+		}
+
+		if(p != k) {
+			for(j = 0; j < w; j++)
+				r_expr_swap(&arr[p * w + j], &arr[k * w + j]);
+
+			*neg = !*neg;
+		}
+
+		piv = arr[k * w + k];
+
+		for(i = (top < k) ? top : (k + 1); i < n; i++) {
+			if(i == k)
+				continue;
+
+			lead = arr[i * w + k];
+			for(j = k + 1; j < w; j++)
+				arr[i * w + j] = mat_step(piv, arr[i * w + j], lead, arr[k * w + j], prev);
+
+			r_expr_set(&arr[i * w + k], r_expr_zero());
+
+			if(i < k)
+				r_expr_set(&arr[i * w + i], r_expr_copy(piv));
+		}
+
+		r_expr_replace(&prev, r_expr_copy(piv));
+	}
+
+	if(prev != NULL)
+		r_expr_delete(prev);
+
+	return true;
+}
+
+/**
+ * Decide if a nonzero entry is a better pivot than the current best. Float
+ * entries are preferred, as they are known to be nonzero, and among them
+ * the largest magnitude keeps the rounding error small. Symbolic entries
+ * fall back to the smallest expression.
+ *   @ent: The entry.
+ *   @best: The current best pivot.
+ *   &returns: True if the entry is better.
+ */
+static bool mat_pivot(const struct r_expr_t *ent, const struct r_expr_t *best)
+{
+	if((ent->type == r_flt_v) != (best->type == r_flt_v))
+		return ent->type == r_flt_v;
+	else if(ent->type == r_flt_v)
+		return fabs(ent->data.flt) > fabs(best->data.flt);
+	else
+		return ent->size < best->size;
+}
+
+/**
+ * Compute a single fraction-free elimination step. When every operand is
+ * a float, a result within rounding error of zero relative to the terms
+ * that produced it is taken to be an exact zero, so the cancellation is
+ * never chosen as a pivot.
+ *   @piv: The pivot.
+ *   @ent: Consumed. The entry.
+ *   @lead: The leading entry of the row of the entry.
+ *   @top: The entry of the pivot row in the column of the entry.
+ *   @prev: Optional. The previous pivot.
+ *   &returns: The updated entry.
+ */
+static struct r_expr_t *mat_step(struct r_expr_t *piv, struct r_expr_t *ent, struct r_expr_t *lead, struct r_expr_t *top, struct r_expr_t *prev)
+{
+	double scale = NAN;
+	struct r_expr_t *expr;
+
+	if((piv->type == r_flt_v) && (ent->type == r_flt_v) && (lead->type == r_flt_v) && (top->type == r_flt_v) && ((prev == NULL) || (prev->type == r_flt_v)))
+		scale = (fabs(piv->data.flt * ent->data.flt) + fabs(lead->data.flt * top->data.flt)) / ((prev != NULL) ? fabs(prev->data.flt) : 1.0);
+
+	if(r_expr_is_zero(lead) || r_expr_is_zero(top)) {
+		if(r_expr_is_zero(ent))
+			return ent;
+
+		expr = r_expr_mul(r_expr_copy(piv), ent);
+	}
+	else if(r_expr_is_zero(ent)) {
+		r_expr_delete(ent);
+		expr = r_expr_neg(r_expr_mul(r_expr_copy(lead), r_expr_copy(top)));
+	}
+	else
+		expr = r_expr_sub(r_expr_mul(r_expr_copy(piv), ent), r_expr_mul(r_expr_copy(lead), r_expr_copy(top)));
+
+	if(prev != NULL)
+		expr = r_expr_div(expr, r_expr_copy(prev));
+
+	expr = r_fold_expr_clr(expr);
+	if((expr->type == r_flt_v) && (fabs(expr->data.flt) <= (RMAT_TOL * scale)))
+		r_expr_replace(&expr, r_expr_zero());
+
+	return expr;
+}
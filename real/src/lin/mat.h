@@ -1,6 +1,12 @@
 #ifndef LIN_MAT_H
 #define LIN_MAT_H
 
+/*
+ * expression matrix definitions
+ */
+#define RMAT_TOL 1e-12
+#define RMAT_PIVOT 0.1
+
 /**
  * Expression matrix structure.
  *   @width, height: The width and height.
@@ -28,10 +34,36 @@ struct r_expr_t *rmat_expr_det(struct rmat_expr_t *mat);
 struct r_expr_t *rmat_expr_det_clr(struct rmat_expr_t *mat);
 
 struct rmat_expr_t *rmat_expr_inv(struct rmat_expr_t *mat);
+struct rvec_expr_t *rmat_expr_solve(struct rmat_expr_t *mat, struct rvec_expr_t *vec, const unsigned int *idx, unsigned int cnt);
+
+struct rmat_expr_t *rmat_expr_jacob(struct r_sys_t *sys, struct rvec_var_t *var);
 
 struct rmat_expr_t *rmat_expr_exclude(struct rmat_expr_t *mat, unsigned int row, unsigned int col);
 
 
+/**
+ * Sparse expression matrix structure, storing only the nonzero entries of
+ * each row as a list ordered by column.
+ *   @width, height: The width and height.
+ *   @row: The row array.
+ */
+struct rmat_sparse_t {
+	unsigned int width, height;
+	struct r_grad_t **row;
+};
+
+/*
+ * sparse matrix declarations
+ */
+struct rmat_sparse_t *rmat_sparse_new(unsigned int width, unsigned int height);
+void rmat_sparse_delete(struct rmat_sparse_t *mat);
+
+void rmat_sparse_dump(struct rmat_sparse_t *mat);
+
+char *rmat_sparse_sys(struct rmat_sparse_t **mat, struct rvec_expr_t **vec, struct r_sys_t *sys, struct rvec_var_t *var);
+struct rvec_expr_t *rmat_sparse_solve(struct rmat_sparse_t *mat, struct rvec_expr_t *vec, const unsigned int *idx, unsigned int cnt);
+
+
 /**
  * Float matrix structure.
  *   @width, height: The width and height.
@@ -1,6 +1,42 @@
 #include "../common.h"
 
 
+/**
+ * Variable index structure.
+ *   @var: The variable.
+ *   @idx: The index.
+ */
+struct idx_t {
+	const struct r_var_t *var;
+	unsigned int idx;
+};
+
+/**
+ * Memoized gradient structure.
+ *   @expr: The expression.
+ *   @grad: The gradient.
+ */
+struct memo_t {
+	struct r_expr_t *expr;
+	struct r_grad_t *grad;
+};
+
+/*
+ * local declarations
+ */
+static struct r_grad_t *diff_grad(struct r_diff_t *diff, struct r_expr_t *expr);
+static bool diff_lin(struct r_diff_t *diff, struct r_expr_t *expr, struct r_grad_t **coef, struct r_expr_t **cst);
+
+static struct r_grad_t *grad_comb(const struct r_grad_t *left, struct r_expr_t *lmul, const struct r_grad_t *right, struct r_expr_t *rmul, bool sub);
+static struct r_grad_t *grad_map(const struct r_grad_t *grad, enum r_expr_e type, struct r_expr_t *arg);
+static struct r_grad_t **grad_add(struct r_grad_t **grad, unsigned int idx, struct r_expr_t *expr);
+
+static uint64_t ptr_hash(const void *ptr);
+static int idx_cmp(const void *left, const void *right);
+static int memo_cmp(const void *left, const void *right);
+static void memo_delete(void *ptr);
+
+
 /**
  * Compute the derivative of an expression.
  *   @expr: The expression.
@@ -57,10 +93,10 @@ struct r_expr_t *r_deriv_expr(struct r_expr_t *expr, struct r_var_t *var)
 			low = expr->data.op2.left;
 			high = expr->data.op2.right;
 
-			left = r_expr_mul(r_expr_copy(low), r_deriv_expr(high, var));
-			right = r_expr_mul(r_expr_copy(high), r_deriv_expr(low, var));
+			left = r_expr_mul(r_deriv_expr(low, var), r_expr_copy(high));
+			right = r_expr_mul(r_expr_copy(low), r_deriv_expr(high, var));
 
-			return r_expr_div(r_expr_mul(left, right), r_expr_mul(r_expr_copy(low), r_expr_copy(low)));
+			return r_expr_div(r_expr_sub(left, right), r_expr_mul(r_expr_copy(high), r_expr_copy(high)));
 		}
 
 	case r_sum_v:
@@ -141,3 +177,426 @@ struct r_expr_t *r_const_expr(struct r_expr_t *expr)
 
 	__builtin_unreachable();
 }
+
+
+/**
+ * Create a differentiation context over a set of variables. Variables are
+ * matched by reference, as in `r_deriv_expr`.
+ *   @var: The variables, which must outlive the context.
+ *   &returns: The context.
+ */
+struct r_diff_t *r_diff_new(struct rvec_var_t *var)
+{
+	unsigned int i;
+	struct idx_t *ent;
+	struct r_diff_t *diff;
+
+	diff = malloc(sizeof(struct r_diff_t));
+	diff->var = var;
+	diff->idx = hashset_init(idx_cmp, free);
+	diff->memo = hashset_init(memo_cmp, memo_delete);
+
+	for(i = 0; i < var->len; i++) {
+		ent = malloc(sizeof(struct idx_t));
+		*ent = (struct idx_t){ var->arr[i], i };
+
+		if(hashset_insert(&diff->idx, ptr_hash(ent->var), ent) != NULL)
+			free(ent);
+	}
+
+	return diff;
+}
+
+/**
+ * Delete a differentiation context.
+ *   @diff: The context.
+ */
+void r_diff_delete(struct r_diff_t *diff)
+{
+	hashset_destroy(&diff->idx);
+	hashset_destroy(&diff->memo);
+	free(diff);
+}
+
+
+/**
+ * Compute the sparse gradient of an expression with respect to every
+ * variable of the context in one pass. The gradient of each shared node
+ * is computed once and kept for the lifetime of the context, so the
+ * gradients of many expressions take time linear in their total size.
+ *   @diff: The context.
+ *   @expr: The expression.
+ *   &returns: The gradient, owned by the context, omitting zero partials.
+ */
+const struct r_grad_t *r_diff_grad(struct r_diff_t *diff, struct r_expr_t *expr)
+{
+	return diff_grad(diff, expr);
+}
+
+/**
+ * Compute or retrieve the memoized gradient of an expression.
+ *   @diff: The context.
+ *   @expr: The expression.
+ *   &returns: The gradient, owned by the context.
+ */
+static struct r_grad_t *diff_grad(struct r_diff_t *diff, struct r_expr_t *expr)
+{
+	struct idx_t *idx;
+	struct memo_t *memo;
+	struct r_grad_t *grad, *tmp;
+	struct r_list_t *list;
+
+	memo = hashset_lookup(&diff->memo, ptr_hash(expr), &(struct memo_t){ expr, NULL });
+	if(memo != NULL)
+		return memo->grad;
+
+	switch(expr->type) {
+	case r_unk_v:
+	case r_flt_v:
+	case r_num_v:
+	case r_const_v:
+		grad = NULL;
+		break;
+
+	case r_var_v:
+		grad = NULL;
+		idx = hashset_lookup(&diff->idx, ptr_hash(expr->data.var), &(struct idx_t){ expr->data.var, 0 });
+		if(idx != NULL)
+			grad_add(&grad, idx->idx, r_expr_one());
+
+		break;
+
+	case r_neg_v:
+		grad = grad_map(diff_grad(diff, expr->data.expr), r_neg_v, NULL);
+		break;
+
+	case r_add_v:
+	case r_sub_v:
+		grad = grad_comb(diff_grad(diff, expr->data.op2.left), NULL, diff_grad(diff, expr->data.op2.right), NULL, expr->type == r_sub_v);
+		break;
+
+	case r_mul_v:
+		grad = grad_comb(diff_grad(diff, expr->data.op2.left), expr->data.op2.right, diff_grad(diff, expr->data.op2.right), expr->data.op2.left, false);
+		break;
+
+	case r_div_v:
+		tmp = grad_comb(diff_grad(diff, expr->data.op2.left), expr->data.op2.right, diff_grad(diff, expr->data.op2.right), expr->data.op2.left, true);
+		grad = grad_map(tmp, r_div_v, r_expr_mul(r_expr_copy(expr->data.op2.right), r_expr_copy(expr->data.op2.right)));
+		r_grad_delete(tmp);
+		break;
+
+	case r_sum_v:
+		grad = NULL;
+		for(list = expr->data.list; list != NULL; list = list->next) {
+			tmp = grad;
+			grad = grad_comb(tmp, NULL, diff_grad(diff, list->expr), NULL, false);
+			r_grad_delete(tmp);
+		}
+
+		break;
+
+	default:
+		__builtin_unreachable();
+	}
+
+	memo = malloc(sizeof(struct memo_t));
+	*memo = (struct memo_t){ r_expr_copy(expr), grad };
+	hashset_insert(&diff->memo, ptr_hash(expr), memo);
+
+	return grad;
+}
+
+
+/**
+ * Split an expression into its coefficients and constant term in a single
+ * walk, requiring it to be linear in the variables of the context. Other
+ * variables are treated as constants.
+ *   @diff: The context.
+ *   @expr: The expression.
+ *   @coef: Out. The coefficients, omitting zeros.
+ *   @cst: Out. The constant term.
+ *   &returns: Error.
+ */
+char *r_diff_lin(struct r_diff_t *diff, struct r_expr_t *expr, struct r_grad_t **coef, struct r_expr_t **cst)
+{
+	if(!diff_lin(diff, expr, coef, cst))
+		return mprintf("Expression is not linear in the variables.");
+
+	return NULL;
+}
+
+/**
+ * Recursively split a linear expression.
+ *   @diff: The context.
+ *   @expr: The expression.
+ *   @coef: Out. The coefficients.
+ *   @cst: Out. The constant term.
+ *   &returns: True if linear.
+ */
+static bool diff_lin(struct r_diff_t *diff, struct r_expr_t *expr, struct r_grad_t **coef, struct r_expr_t **cst)
+{
+	struct idx_t *idx;
+	struct r_grad_t *lcoef, *rcoef;
+	struct r_expr_t *lcst, *rcst;
+	struct r_list_t *list;
+
+	switch(expr->type) {
+	case r_unk_v:
+	case r_flt_v:
+	case r_num_v:
+	case r_const_v:
+		*coef = NULL;
+		*cst = r_expr_copy(expr);
+		return true;
+
+	case r_var_v:
+		*coef = NULL;
+		idx = hashset_lookup(&diff->idx, ptr_hash(expr->data.var), &(struct idx_t){ expr->data.var, 0 });
+		if(idx == NULL)
+			*cst = r_expr_copy(expr);
+		else {
+			grad_add(coef, idx->idx, r_expr_one());
+			*cst = r_expr_zero();
+		}
+
+		return true;
+
+	case r_neg_v:
+		if(!diff_lin(diff, expr->data.expr, &lcoef, &lcst))
+			return false;
+
+		*coef = grad_map(lcoef, r_neg_v, NULL);
+		*cst = r_fold_expr_clr(r_expr_neg(lcst));
+		r_grad_delete(lcoef);
+
+		return true;
+
+	case r_add_v:
+	case r_sub_v:
+	case r_mul_v:
+	case r_div_v:
+		if(!diff_lin(diff, expr->data.op2.left, &lcoef, &lcst))
+			return false;
+
+		if(!diff_lin(diff, expr->data.op2.right, &rcoef, &rcst)) {
+			r_grad_delete(lcoef);
+			r_expr_delete(lcst);
+
+			return false;
+		}
+
+		if(((expr->type == r_mul_v) && (lcoef != NULL) && (rcoef != NULL)) || ((expr->type == r_div_v) && (rcoef != NULL))) {
+			r_grad_delete(lcoef);
+			r_grad_delete(rcoef);
+			r_expr_delete(lcst);
+			r_expr_delete(rcst);
+
+			return false;
+		}
+
+		switch(expr->type) {
+		case r_add_v:
+			*coef = grad_comb(lcoef, NULL, rcoef, NULL, false);
+			*cst = r_fold_expr_clr(r_expr_add(lcst, rcst));
+			break;
+
+		case r_sub_v:
+			*coef = grad_comb(lcoef, NULL, rcoef, NULL, true);
+			*cst = r_fold_expr_clr(r_expr_sub(lcst, rcst));
+			break;
+
+		case r_mul_v:
+			*coef = grad_comb(lcoef, rcst, rcoef, lcst, false);
+			*cst = r_fold_expr_clr(r_expr_mul(lcst, rcst));
+			break;
+
+		case r_div_v:
+			*coef = grad_map(lcoef, r_div_v, r_expr_copy(rcst));
+			*cst = r_fold_expr_clr(r_expr_div(lcst, rcst));
+			break;
+
+		default:
+			__builtin_unreachable();
+		}
+
+		r_grad_delete(lcoef);
+		r_grad_delete(rcoef);
+
+		return true;
+
+	case r_sum_v:
+		*coef = NULL;
+		*cst = r_expr_zero();
+
+		for(list = expr->data.list; list != NULL; list = list->next) {
+			if(!diff_lin(diff, list->expr, &rcoef, &rcst)) {
+				r_grad_delete(*coef);
+				r_expr_delete(*cst);
+
+				return false;
+			}
+
+			lcoef = *coef;
+			*coef = grad_comb(lcoef, NULL, rcoef, NULL, false);
+			*cst = r_fold_expr_clr(r_expr_add(*cst, rcst));
+			r_grad_delete(lcoef);
+			r_grad_delete(rcoef);
+		}
+
+		return true;
+	}
+
+	__builtin_unreachable();
+}
+
+
+/**
+ * Delete a gradient.
+ *   @grad: The gradient.
+ */
+void r_grad_delete(struct r_grad_t *grad)
+{
+	struct r_grad_t *tmp;
+
+	while(grad != NULL) {
+		tmp = grad;
+		grad = tmp->next;
+
+		r_expr_delete(tmp->expr);
+		free(tmp);
+	}
+}
+
+/**
+ * Combine two gradients term by term as `left * lmul +/- rmul * right`.
+ *   @left: The left gradient.
+ *   @lmul: Optional. The left multiplier.
+ *   @right: The right gradient.
+ *   @rmul: Optional. The right multiplier.
+ *   @sub: Subtract the right term instead of adding it.
+ *   &returns: The combined gradient.
+ */
+static struct r_grad_t *grad_comb(const struct r_grad_t *left, struct r_expr_t *lmul, const struct r_grad_t *right, struct r_expr_t *rmul, bool sub)
+{
+	struct r_expr_t *lterm, *rterm;
+	struct r_grad_t *grad = NULL, **iter = &grad;
+
+	while((left != NULL) || (right != NULL)) {
+		lterm = rterm = NULL;
+
+		if((left != NULL) && ((right == NULL) || (left->idx <= right->idx)))
+			lterm = (lmul != NULL) ? r_expr_mul(r_expr_copy(left->expr), r_expr_copy(lmul)) : r_expr_copy(left->expr);
+
+		if((right != NULL) && ((left == NULL) || (right->idx <= left->idx)))
+			rterm = (rmul != NULL) ? r_expr_mul(r_expr_copy(rmul), r_expr_copy(right->expr)) : r_expr_copy(right->expr);
+
+		if(rterm == NULL)
+			iter = grad_add(iter, left->idx, lterm), left = left->next;
+		else if(lterm == NULL)
+			iter = grad_add(iter, right->idx, sub ? r_expr_neg(rterm) : rterm), right = right->next;
+		else {
+			iter = grad_add(iter, left->idx, sub ? r_expr_sub(lterm, rterm) : r_expr_add(lterm, rterm));
+			left = left->next;
+			right = right->next;
+		}
+	}
+
+	return grad;
+}
+
+/**
+ * Apply an operation to every term of a gradient.
+ *   @grad: The gradient.
+ *   @type: The operation, either negation or division.
+ *   @arg: Consumed. Optional. The divisor.
+ *   &returns: The mapped gradient.
+ */
+static struct r_grad_t *grad_map(const struct r_grad_t *grad, enum r_expr_e type, struct r_expr_t *arg)
+{
+	struct r_grad_t *res = NULL, **iter = &res;
+
+	for(; grad != NULL; grad = grad->next) {
+		switch(type) {
+		case r_neg_v: iter = grad_add(iter, grad->idx, r_expr_neg(r_expr_copy(grad->expr))); break;
+		case r_div_v: iter = grad_add(iter, grad->idx, r_expr_div(r_expr_copy(grad->expr), r_expr_copy(arg))); break;
+		default: __builtin_unreachable();
+		}
+	}
+
+	if(arg != NULL)
+		r_expr_delete(arg);
+
+	return res;
+}
+
+/**
+ * Fold and append a partial to a gradient, dropping it if zero.
+ *   @grad: The gradient reference.
+ *   @idx: The variable index.
+ *   @expr: Consumed. The partial.
+ *   &returns: The reference following the gradient.
+ */
+static struct r_grad_t **grad_add(struct r_grad_t **grad, unsigned int idx, struct r_expr_t *expr)
+{
+	expr = r_fold_expr_clr(expr);
+	if(r_expr_is_zero(expr)) {
+		r_expr_delete(expr);
+
+		return grad;
+	}
+
+	*grad = malloc(sizeof(struct r_grad_t));
+	**grad = (struct r_grad_t){ idx, expr, NULL };
+
+	return &(*grad)->next;
+}
+
+
+/**
+ * Compute the hash of a reference.
+ *   @ptr: The reference.
+ *   &returns: The hash.
+ */
+static uint64_t ptr_hash(const void *ptr)
+{
+	uint64_t hash = (uintptr_t)ptr;
+
+	hash *= 0x9E3779B97F4A7C15ul;
+
+	return hash ^ (hash >> 32);
+}
+
+/**
+ * Compare two variable indices by variable.
+ *   @left: The left index.
+ *   @right: The right index.
+ *   &returns: Zero if the variables are the same.
+ */
+static int idx_cmp(const void *left, const void *right)
+{
+	return ((const struct idx_t *)left)->var != ((const struct idx_t *)right)->var;
+}
+
+/**
+ * Compare two memoized gradients by expression.
+ *   @left: The left gradient.
+ *   @right: The right gradient.
+ *   &returns: Zero if the expressions are the same.
+ */
+static int memo_cmp(const void *left, const void *right)
+{
+	return ((const struct memo_t *)left)->expr != ((const struct memo_t *)right)->expr;
+}
+
+/**
+ * Delete a memoized gradient.
+ *   @ptr: The memoized gradient.
+ */
+static void memo_delete(void *ptr)
+{
+	struct memo_t *memo = ptr;
+
+	r_expr_delete(memo->expr);
+	r_grad_delete(memo->grad);
+	free(memo);
+}
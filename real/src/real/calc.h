@@ -1,6 +1,30 @@
 #ifndef REAL_CALC_H
 #define REAL_CALC_H
 
+/**
+ * Sparse gradient structure, ordered by variable index.
+ *   @idx: The variable index.
+ *   @expr: The partial derivative.
+ *   @next: The next partial.
+ */
+struct r_grad_t {
+	unsigned int idx;
+	struct r_expr_t *expr;
+
+	struct r_grad_t *next;
+};
+
+/**
+ * Differentiation structure, caching the gradient of every visited node.
+ *   @var: The variables.
+ *   @idx: The variable indices by reference.
+ *   @memo: The cached gradients by node.
+ */
+struct r_diff_t {
+	struct rvec_var_t *var;
+	struct hashset_t idx, memo;
+};
+
 /*
  * calculus declarations
  */
@@ -8,4 +32,15 @@ struct r_expr_t *r_deriv_expr(struct r_expr_t *expr, struct r_var_t *var);
 
 struct r_expr_t *r_const_expr(struct r_expr_t *expr);
 
+/*
+ * differentiation declarations
+ */
+struct r_diff_t *r_diff_new(struct rvec_var_t *var);
+void r_diff_delete(struct r_diff_t *diff);
+
+const struct r_grad_t *r_diff_grad(struct r_diff_t *diff, struct r_expr_t *expr);
+char *r_diff_lin(struct r_diff_t *diff, struct r_expr_t *expr, struct r_grad_t **coef, struct r_expr_t **cst);
+
+void r_grad_delete(struct r_grad_t *grad);
+
 #endif
@@ -1,6 +1,23 @@
 #include "../common.h"
 
 
+/**
+ * Memoized value structure.
+ *   @expr: The expression.
+ *   @flt: The value.
+ */
+struct memo_t {
+	const struct r_expr_t *expr;
+	double flt;
+};
+
+/*
+ * local declarations
+ */
+static char *eval_expr(struct r_expr_t *expr, struct r_env_t *env, struct hashset_t *memo, double *res);
+static int memo_cmp(const void *left, const void *right);
+
+
 /**
  * Create a new environment.
  *   &returns: The environment.
@@ -72,7 +89,7 @@ void r_env_put(struct r_env_t **env, const char *id, double flt)
 
 
 /**
- * Evaluate an expression.
+ * Evaluate an expression. Shared subexpressions are evaluated once.
  *   @expr: The expression.
  *   @env: The environment.
  *   @res: The result.
@@ -80,6 +97,38 @@ void r_env_put(struct r_env_t **env, const char *id, double flt)
  */
 char *r_eval_expr(struct r_expr_t *expr, struct r_env_t *env, double *res)
 {
+	char *err;
+	struct hashset_t memo;
+
+	memo = hashset_init(memo_cmp, free);
+	err = eval_expr(expr, env, &memo, res);
+	hashset_destroy(&memo);
+
+	return err;
+}
+
+
+/**
+ * Evaluate an expression, memoizing shared nodes.
+ *   @expr: The expression.
+ *   @env: The environment.
+ *   @memo: The memoized values.
+ *   @res: The result.
+ *   &returns: Error.
+ */
+static char *eval_expr(struct r_expr_t *expr, struct r_env_t *env, struct hashset_t *memo, double *res)
+{
+	struct memo_t *ent;
+
+	if(expr->refcnt > 1) {
+		ent = hashset_lookup(memo, expr->hash, &(struct memo_t){ expr, 0.0 });
+		if(ent != NULL) {
+			*res = ent->flt;
+
+			return NULL;
+		}
+	}
+
 	switch(expr->type) {
 	case r_unk_v:
 		*res = NAN;
@@ -118,7 +167,7 @@ char *r_eval_expr(struct r_expr_t *expr, struct r_env_t *env, double *res)
 		break;
 
 	case r_neg_v:
-		chkret(r_eval_expr(expr->data.expr, env, res));
+		chkret(eval_expr(expr->data.expr, env, memo, res));
 		*res = -*res;
 		break;
 
@@ -129,8 +178,8 @@ char *r_eval_expr(struct r_expr_t *expr, struct r_env_t *env, double *res)
 		{
 			double left, right;
 
-			chkret(r_eval_expr(expr->data.op2.left, env, &left));
-			chkret(r_eval_expr(expr->data.op2.right, env, &right));
+			chkret(eval_expr(expr->data.op2.left, env, memo, &left));
+			chkret(eval_expr(expr->data.op2.right, env, memo, &right));
 
 			switch(expr->type) {
 			case r_add_v: *res = left + right; break;
@@ -149,12 +198,29 @@ char *r_eval_expr(struct r_expr_t *expr, struct r_env_t *env, double *res)
 
 			*res = 0.0;
 			for(list = expr->data.list; list != NULL; list = list->next) {
-				chkret(r_eval_expr(list->expr, env, &tmp));
+				chkret(eval_expr(list->expr, env, memo, &tmp));
 				*res += tmp;
 			}
 		}
 		break;
 	}
 
+	if(expr->refcnt > 1) {
+		ent = malloc(sizeof(struct memo_t));
+		*ent = (struct memo_t){ expr, *res };
+		hashset_insert(memo, expr->hash, ent);
+	}
+
 	return NULL;
 }
+
+/**
+ * Compare two memoized values by expression.
+ *   @left: The left value.
+ *   @right: The right value.
+ *   &returns: Zero if the expressions are the same.
+ */
+static int memo_cmp(const void *left, const void *right)
+{
+	return ((const struct memo_t *)left)->expr != ((const struct memo_t *)right)->expr;
+}
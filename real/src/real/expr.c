@@ -7,45 +7,62 @@
 static void expr_proc(struct io_file_t file, void *arg);
 static void num_proc(struct io_file_t file, void *arg);
 
+static void expr_clear(enum r_expr_e type, union r_expr_u data);
+static uint64_t expr_hash(enum r_expr_e type, union r_expr_u data);
+static unsigned int expr_size(enum r_expr_e type, union r_expr_u data);
+static int expr_cmp(const void *left, const void *right);
+static uint64_t expr_mix(uint64_t hash, uint64_t val);
+
+/*
+ * local variables
+ */
+static struct hashset_t expr_set = { NULL };
+
 
 /**
- * Create a expression.
+ * Create a expression, or retrieve the existing equal expression.
  *   @type: The type.
  *   @data: Consumed. The data.
  *   &returns: The expression.
  */
 struct r_expr_t *r_expr_new(enum r_expr_e type, union r_expr_u data)
 {
-	struct r_expr_t *expr;
+	struct r_expr_t *expr, key;
+
+	key.type = type;
+	key.data = data;
+	key.hash = expr_hash(type, data);
+
+	if(expr_set.ent == NULL)
+		expr_set = hashset_init(expr_cmp, delete_noop);
+	else if((type != r_unk_v) && ((expr = hashset_lookup(&expr_set, key.hash, &key)) != NULL)) {
+		expr_clear(type, data);
+		expr->refcnt++;
+
+		return expr;
+	}
 
 	expr = malloc(sizeof(struct r_expr_t));
-	*expr = (struct r_expr_t){ type, data };
+	*expr = (struct r_expr_t){ type, data, key.hash, 1, expr_size(type, data), false };
+
+	if(type == r_unk_v)
+		expr->hash = expr_mix(expr->hash, (uintptr_t)expr);
+
+	hashset_insert(&expr_set, expr->hash, expr);
 
 	return expr;
 }
 
 /**
- * Copy an expression.
+ * Copy an expression. Only the reference count is changed.
  *   @expr: The original expression.
  *   &returns: The copied expression.
  */
 struct r_expr_t *r_expr_copy(struct r_expr_t *expr)
 {
-	switch(expr->type) {
-	case r_unk_v: return r_expr_unk();
-	case r_flt_v: return r_expr_flt(expr->data.flt);
-	case r_num_v: return r_expr_num(r_num_copy(expr->data.num));
-	case r_var_v: return r_expr_var(r_var_copy(expr->data.var));
-	case r_const_v: return r_expr_const(strdup(expr->data.name));
-	case r_neg_v: return r_expr_neg(r_expr_copy(expr->data.expr));
-	case r_add_v: return r_expr_add(r_expr_copy(expr->data.op2.left), r_expr_copy(expr->data.op2.right));
-	case r_sub_v: return r_expr_sub(r_expr_copy(expr->data.op2.left), r_expr_copy(expr->data.op2.right));
-	case r_mul_v: return r_expr_mul(r_expr_copy(expr->data.op2.left), r_expr_copy(expr->data.op2.right));
-	case r_div_v: return r_expr_div(r_expr_copy(expr->data.op2.left), r_expr_copy(expr->data.op2.right));
-	case r_sum_v: return r_expr_sum(r_list_copy(expr->data.list));
-	}
+	expr->refcnt++;
 
-	fatal("Invalid real expression type.");
+	return expr;
 }
 
 /**
@@ -54,40 +71,16 @@ struct r_expr_t *r_expr_copy(struct r_expr_t *expr)
  */
 void r_expr_delete(struct r_expr_t *expr)
 {
-	switch(expr->type) {
-	case r_unk_v:
-	case r_flt_v:
-		break;
-
-	case r_num_v:
-		r_num_delete(expr->data.num);
-		break;
-
-	case r_const_v:
-		free(expr->data.name);
-		break;
-
-	case r_var_v:
-		r_var_delete(expr->data.var);
-		break;
-
-	case r_neg_v:
-		r_expr_delete(expr->data.expr);
-		break;
-
-	case r_add_v:
-	case r_sub_v:
-	case r_mul_v:
-	case r_div_v:
-		r_expr_delete(expr->data.op2.left);
-		r_expr_delete(expr->data.op2.right);
-		break;
+	if(expr->refcnt-- > 1)
+		return;
 
-	case r_sum_v:
-		r_list_delete(expr->data.list);
-		break;
+	hashset_remove(&expr_set, expr->hash, expr);
+	if(expr_set.count == 0) {
+		hashset_destroy(&expr_set);
+		expr_set.ent = NULL;
 	}
 
+	expr_clear(expr->type, expr->data);
 	free(expr);
 }
 
@@ -391,6 +384,219 @@ static void expr_proc(struct io_file_t file, void *arg)
 }
 
 
+/**
+ * Release the data of an expression.
+ *   @type: The type.
+ *   @data: The data.
+ */
+static void expr_clear(enum r_expr_e type, union r_expr_u data)
+{
+	switch(type) {
+	case r_unk_v:
+	case r_flt_v:
+		break;
+
+	case r_num_v:
+		r_num_delete(data.num);
+		break;
+
+	case r_const_v:
+		free(data.name);
+		break;
+
+	case r_var_v:
+		r_var_delete(data.var);
+		break;
+
+	case r_neg_v:
+		r_expr_delete(data.expr);
+		break;
+
+	case r_add_v:
+	case r_sub_v:
+	case r_mul_v:
+	case r_div_v:
+		r_expr_delete(data.op2.left);
+		r_expr_delete(data.op2.right);
+		break;
+
+	case r_sum_v:
+		r_list_delete(data.list);
+		break;
+	}
+}
+
+/**
+ * Compute the structural hash of expression data. Subexpressions are
+ * already unique, so only their hashes are mixed in.
+ *   @type: The type.
+ *   @data: The data.
+ *   &returns: The hash.
+ */
+static uint64_t expr_hash(enum r_expr_e type, union r_expr_u data)
+{
+	size_t i;
+	uint64_t hash, bits;
+	struct r_list_t *list;
+
+	hash = expr_mix(0, type);
+
+	switch(type) {
+	case r_unk_v:
+		break;
+
+	case r_flt_v:
+		memcpy(&bits, &data.flt, sizeof(uint64_t));
+		hash = expr_mix(hash, bits);
+		break;
+
+	case r_num_v:
+		hash = expr_mix(hash, mpz_sgn(data.num->mpz));
+		for(i = 0; i < mpz_size(data.num->mpz); i++)
+			hash = expr_mix(hash, mpz_getlimbn(data.num->mpz, i));
+
+		break;
+
+	case r_const_v:
+		for(i = 0; data.name[i] != '\0'; i++)
+			hash = expr_mix(hash, (unsigned char)data.name[i]);
+
+		break;
+
+	case r_var_v:
+		hash = expr_mix(hash, (uintptr_t)data.var);
+		break;
+
+	case r_neg_v:
+		hash = expr_mix(hash, data.expr->hash);
+		break;
+
+	case r_add_v:
+	case r_sub_v:
+	case r_mul_v:
+	case r_div_v:
+		hash = expr_mix(hash, data.op2.left->hash);
+		hash = expr_mix(hash, data.op2.right->hash);
+		break;
+
+	case r_sum_v:
+		for(list = data.list; list != NULL; list = list->next)
+			hash = expr_mix(hash, list->expr->hash);
+
+		break;
+	}
+
+	return hash;
+}
+
+/**
+ * Compute the tree size of expression data, saturating at the maximum.
+ *   @type: The type.
+ *   @data: The data.
+ *   &returns: The size.
+ */
+static unsigned int expr_size(enum r_expr_e type, union r_expr_u data)
+{
+	uint64_t size = 1;
+	struct r_list_t *list;
+
+	switch(type) {
+	case r_unk_v:
+	case r_flt_v:
+	case r_num_v:
+	case r_const_v:
+	case r_var_v:
+		break;
+
+	case r_neg_v:
+		size += data.expr->size;
+		break;
+
+	case r_add_v:
+	case r_sub_v:
+	case r_mul_v:
+	case r_div_v:
+		size += (uint64_t)data.op2.left->size + data.op2.right->size;
+		break;
+
+	case r_sum_v:
+		for(list = data.list; (list != NULL) && (size < UINT_MAX); list = list->next)
+			size += list->expr->size;
+
+		break;
+	}
+
+	return (size < UINT_MAX) ? size : UINT_MAX;
+}
+
+/**
+ * Compare two expressions for the expression set. Subexpressions are
+ * compared by reference.
+ *   @left: The left expression.
+ *   @right: The right expression.
+ *   &returns: Zero if equal, nonzero otherwise.
+ */
+static int expr_cmp(const void *left, const void *right)
+{
+	const struct r_expr_t *a = left, *b = right;
+	const struct r_list_t *x, *y;
+
+	if(a->type != b->type)
+		return 1;
+
+	switch(a->type) {
+	case r_unk_v:
+		return a != b;
+
+	case r_flt_v:
+		return memcmp(&a->data.flt, &b->data.flt, sizeof(double)) != 0;
+
+	case r_num_v:
+		return mpz_cmp(a->data.num->mpz, b->data.num->mpz) != 0;
+
+	case r_const_v:
+		return strcmp(a->data.name, b->data.name) != 0;
+
+	case r_var_v:
+		return a->data.var != b->data.var;
+
+	case r_neg_v:
+		return a->data.expr != b->data.expr;
+
+	case r_add_v:
+	case r_sub_v:
+	case r_mul_v:
+	case r_div_v:
+		return (a->data.op2.left != b->data.op2.left) || (a->data.op2.right != b->data.op2.right);
+
+	case r_sum_v:
+		for(x = a->data.list, y = b->data.list; (x != NULL) && (y != NULL); x = x->next, y = y->next) {
+			if(x->expr != y->expr)
+				return 1;
+		}
+
+		return (x != NULL) || (y != NULL);
+	}
+
+	__builtin_unreachable();
+}
+
+/**
+ * Mix a value into a hash.
+ *   @hash: The hash.
+ *   @val: The value.
+ *   &returns: The mixed hash.
+ */
+static uint64_t expr_mix(uint64_t hash, uint64_t val)
+{
+	hash ^= val + 0x9E3779B97F4A7C15ul + (hash << 6) + (hash >> 2);
+	hash ^= hash >> 31;
+	hash *= 0xBF58476D1CE4E5B9ul;
+
+	return hash ^ (hash >> 29);
+}
+
+
 /**
  * Create a new number.
  *   @val: The initial value.
@@ -66,13 +66,24 @@ union r_expr_u {
 };
 
 /**
- * Real expression structure.
+ * Real expression structure. Expressions are hash-consed: structurally
+ * equal expressions are the same reference-counted node, so nodes must
+ * never be modified after creation. Unknowns are the exception, each one
+ * is a distinct node.
  *   @type: The type.
  *   @data: The data.
+ *   @hash: The structural hash.
+ *   @refcnt: The reference count.
+ *   @size: The number of nodes as a tree, saturating.
+ *   @fold: Flag indicating the expression is constant folded.
  */
 struct r_expr_t {
 	enum r_expr_e type;
 	union r_expr_u data;
+
+	uint64_t hash;
+	unsigned int refcnt, size;
+	bool fold;
 };
 
 /**
@@ -120,6 +131,17 @@ void r_expr_print(const struct r_expr_t *expr, struct io_file_t file);
 struct io_chunk_t r_expr_chunk(const struct r_expr_t *expr);
 
 
+/**
+ * Check if two expressions are structurally equal.
+ *   @left: The left expression.
+ *   @right: The right expression.
+ *   &returns: True if equal.
+ */
+static inline bool r_expr_equal(const struct r_expr_t *left, const struct r_expr_t *right)
+{
+	return left == right;
+}
+
 /**
  * Swapt two expressions.
  *   @left: Ref. The left expression.
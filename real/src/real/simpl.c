@@ -1,143 +1,209 @@
 #include "../common.h"
 
 
+/*
+ * local declarations
+ */
+static struct r_expr_t *fold_op2(enum r_expr_e type, struct r_expr_t *left, struct r_expr_t *right);
+static struct r_expr_t *fold_sum(struct r_list_t *list);
+
+
 /**
- * Fold constant values in an expression.
+ * Fold constant values in an expression. Folded expressions are marked so
+ * that shared subexpressions are only folded once.
  *   @expr: The expression.
  *   &returns: The constant.
  */
 struct r_expr_t *r_fold_expr(struct r_expr_t *expr)
 {
-	return r_fold_expr_clr(r_expr_copy(expr));
-}
+	struct r_expr_t *res, *inner;
+
+	if(expr->fold)
+		return r_expr_copy(expr);
 
-/**
- * Fold constant values in an expression, clearing the input.
- *   @expr: Consumed The expression.
- *   &returns: The constant.
- */
-struct r_expr_t *r_fold_expr_clr(struct r_expr_t *expr)
-{
 	switch(expr->type) {
 	case r_unk_v:
 	case r_flt_v:
 	case r_num_v:
 	case r_const_v:
 	case r_var_v:
-		return expr;
+		res = r_expr_copy(expr);
+		break;
 
 	case r_neg_v:
-		expr->data.expr = r_fold_expr_clr(expr->data.expr);
+		inner = r_fold_expr(expr->data.expr);
 
-		if(expr->data.expr->type == r_flt_v)
-			r_expr_set(&expr, r_expr_flt(-expr->data.expr->data.flt));
-		else if(expr->data.expr->type == r_neg_v)
-			r_expr_set(&expr, r_expr_copy(expr->data.expr->data.expr));
+		if(inner->type == r_flt_v)
+			res = r_expr_flt(-inner->data.flt);
+		else if(inner->type == r_neg_v)
+			res = r_expr_copy(inner->data.expr);
+		else
+			res = r_expr_neg(r_expr_copy(inner));
+
+		r_expr_delete(inner);
+		break;
 
-		return expr;
-	
 	case r_add_v:
 	case r_sub_v:
 	case r_mul_v:
 	case r_div_v:
-		expr->data.op2.left = r_fold_expr_clr(expr->data.op2.left);
-		expr->data.op2.right = r_fold_expr_clr(expr->data.op2.right);
-
-		switch(expr->type) {
-		case r_add_v:
-			if((expr->data.op2.left->type == r_flt_v) && (expr->data.op2.right->type == r_flt_v))
-				r_expr_set(&expr, r_expr_flt(expr->data.op2.left->data.flt + expr->data.op2.right->data.flt));
-			else if(r_expr_is_zero(expr->data.op2.left))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.right));
-			else if(r_expr_is_zero(expr->data.op2.right))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.left));
-
-			break;
-		
-		case r_sub_v:
-			if((expr->data.op2.left->type == r_flt_v) && (expr->data.op2.right->type == r_flt_v))
-				r_expr_set(&expr, r_expr_flt(expr->data.op2.left->data.flt - expr->data.op2.right->data.flt));
-			else if(r_expr_is_zero(expr->data.op2.left)) {
-				if(expr->data.op2.right->type == r_flt_v)
-					r_expr_set(&expr, r_expr_flt(-expr->data.op2.right->data.flt));
-				else if(expr->data.op2.right->type == r_neg_v)
-					r_expr_set(&expr, r_expr_copy(expr->data.op2.right->data.expr));
-				else
-					r_expr_set(&expr, r_expr_neg(r_expr_copy(expr->data.op2.right)));
-			}
-			else if(r_expr_is_zero(expr->data.op2.right))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.left));
-
-			break;
-		
-		case r_mul_v:
-			if((expr->data.op2.left->type == r_flt_v) && (expr->data.op2.right->type == r_flt_v))
-				r_expr_set(&expr, r_expr_flt(expr->data.op2.left->data.flt * expr->data.op2.right->data.flt));
-			else if(r_expr_is_zero(expr->data.op2.left) || r_expr_is_zero(expr->data.op2.right))
-				r_expr_set(&expr, r_expr_zero());
-			else if(r_expr_is_one(expr->data.op2.left))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.right));
-			else if(r_expr_is_one(expr->data.op2.right))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.left));
-			else if(r_expr_is_flt(expr->data.op2.left, -1.0))
-				r_expr_set(&expr, r_expr_neg(r_expr_copy(expr->data.op2.right)));
-			else if(r_expr_is_flt(expr->data.op2.right, -1.0))
-				r_expr_set(&expr, r_expr_neg(r_expr_copy(expr->data.op2.left)));
-			else if((expr->data.op2.left->type == r_neg_v) && (expr->data.op2.right->type == r_neg_v))
-				r_expr_set(&expr, r_expr_mul(r_expr_copy(expr->data.op2.left->data.expr), r_expr_copy(expr->data.op2.right->data.expr)));
-
-			break;
-		
-		case r_div_v:
-			if((expr->data.op2.left->type == r_flt_v) && (expr->data.op2.right->type == r_flt_v))
-				r_expr_set(&expr, r_expr_flt(expr->data.op2.left->data.flt / expr->data.op2.right->data.flt));
-			else if(r_expr_is_zero(expr->data.op2.left))
-				r_expr_set(&expr, r_expr_zero());
-			else if(r_expr_is_one(expr->data.op2.right))
-				r_expr_set(&expr, r_expr_copy(expr->data.op2.left));
-			else if((expr->data.op2.left->type == r_neg_v) && (expr->data.op2.right->type == r_neg_v))
-				r_expr_set(&expr, r_expr_div(r_expr_copy(expr->data.op2.left->data.expr), r_expr_copy(expr->data.op2.right->data.expr)));
-
-			break;
-
-		default:
-			__builtin_unreachable();
-		}
-	
-		return expr;
+		res = fold_op2(expr->type, r_fold_expr(expr->data.op2.left), r_fold_expr(expr->data.op2.right));
+		break;
 
 	case r_sum_v:
-		{
-			double flt = 0.0;
-			struct r_list_t **iter = &expr->data.list;
-
-			while(*iter != NULL) {
-				(*iter)->expr = r_fold_expr_clr((*iter)->expr);
-
-				if((*iter)->expr->type == r_flt_v) {
-					flt += (*iter)->expr->data.flt;
-					r_list_purge(iter);
-				}
-				else
-					iter = &(*iter)->next;
-			}
-
-			if(flt == 0.0) {
-				if(expr->data.list == NULL)
-					r_expr_set(&expr, r_expr_zero());
-				else if(expr->data.list->next == NULL)
-					r_expr_set(&expr, r_expr_copy(expr->data.list->expr));
-			}
-			else if(expr->data.list == NULL)
-				r_expr_set(&expr, r_expr_flt(flt));
+		res = fold_sum(expr->data.list);
+		break;
+
+	default:
+		__builtin_unreachable();
+	}
+
+	res->fold = true;
+
+	return res;
+}
+
+/**
+ * Fold constant values in an expression, clearing the input.
+ *   @expr: Consumed The expression.
+ *   &returns: The constant.
+ */
+struct r_expr_t *r_fold_expr_clr(struct r_expr_t *expr)
+{
+	struct r_expr_t *res;
+
+	res = r_fold_expr(expr);
+	r_expr_delete(expr);
+
+	return res;
+}
+
+
+/**
+ * Fold a two operand expression with folded operands.
+ *   @type: The type.
+ *   @left: Consumed. The folded left expression.
+ *   @right: Consumed. The folded right expression.
+ *   &returns: The folded expression.
+ */
+static struct r_expr_t *fold_op2(enum r_expr_e type, struct r_expr_t *left, struct r_expr_t *right)
+{
+	struct r_expr_t *res;
+
+	switch(type) {
+	case r_add_v:
+		if((left->type == r_flt_v) && (right->type == r_flt_v))
+			res = r_expr_flt(left->data.flt + right->data.flt);
+		else if(r_expr_is_zero(left))
+			res = r_expr_copy(right);
+		else if(r_expr_is_zero(right))
+			res = r_expr_copy(left);
+		else
+			res = r_expr_add(r_expr_copy(left), r_expr_copy(right));
+
+		break;
+
+	case r_sub_v:
+		if((left->type == r_flt_v) && (right->type == r_flt_v))
+			res = r_expr_flt(left->data.flt - right->data.flt);
+		else if(r_expr_is_zero(left)) {
+			if(right->type == r_neg_v)
+				res = r_expr_copy(right->data.expr);
 			else
-				r_list_add(iter, r_expr_flt(flt));
+				res = r_expr_neg(r_expr_copy(right));
+		}
+		else if(r_expr_is_zero(right))
+			res = r_expr_copy(left);
+		else
+			res = r_expr_sub(r_expr_copy(left), r_expr_copy(right));
+
+		break;
+
+	case r_mul_v:
+		if((left->type == r_flt_v) && (right->type == r_flt_v))
+			res = r_expr_flt(left->data.flt * right->data.flt);
+		else if(r_expr_is_zero(left) || r_expr_is_zero(right))
+			res = r_expr_zero();
+		else if(r_expr_is_one(left))
+			res = r_expr_copy(right);
+		else if(r_expr_is_one(right))
+			res = r_expr_copy(left);
+		else if(r_expr_is_flt(left, -1.0))
+			res = r_expr_neg(r_expr_copy(right));
+		else if(r_expr_is_flt(right, -1.0))
+			res = r_expr_neg(r_expr_copy(left));
+		else if((left->type == r_neg_v) && (right->type == r_neg_v))
+			res = r_expr_mul(r_expr_copy(left->data.expr), r_expr_copy(right->data.expr));
+		else
+			res = r_expr_mul(r_expr_copy(left), r_expr_copy(right));
+
+		break;
+
+	case r_div_v:
+		if((left->type == r_flt_v) && (right->type == r_flt_v))
+			res = r_expr_flt(left->data.flt / right->data.flt);
+		else if(r_expr_is_zero(left))
+			res = r_expr_zero();
+		else if(r_expr_is_one(right))
+			res = r_expr_copy(left);
+		else if((left->type == r_neg_v) && (right->type == r_neg_v))
+			res = r_expr_div(r_expr_copy(left->data.expr), r_expr_copy(right->data.expr));
+		else
+			res = r_expr_div(r_expr_copy(left), r_expr_copy(right));
+
+		break;
+
+	default:
+		__builtin_unreachable();
+	}
+
+	r_expr_delete(left);
+	r_expr_delete(right);
+
+	return res;
+}
+
+/**
+ * Fold a sum, accumulating its constant terms at the end.
+ *   @list: The list of terms.
+ *   &returns: The folded expression.
+ */
+static struct r_expr_t *fold_sum(struct r_list_t *list)
+{
+	double flt = 0.0;
+	struct r_expr_t *expr;
+	struct r_list_t *res, **iter;
+
+	res = r_list_new();
+	iter = &res;
+
+	for(; list != NULL; list = list->next) {
+		expr = r_fold_expr(list->expr);
+
+		if(expr->type == r_flt_v) {
+			flt += expr->data.flt;
+			r_expr_delete(expr);
+		}
+		else
+			iter = r_list_add(iter, expr);
+	}
+
+	if(flt == 0.0) {
+		if(res == NULL)
+			return r_expr_zero();
+		else if(res->next == NULL) {
+			expr = r_expr_copy(res->expr);
+			r_list_delete(res);
 
 			return expr;
 		}
 	}
+	else if(res == NULL)
+		return r_expr_flt(flt);
+	else
+		r_list_add(iter, r_expr_flt(flt));
 
-	__builtin_unreachable();
+	return r_expr_sum(res);
 }
 
 
@@ -0,0 +1,34 @@
+#include "common.h"
+
+
+/*
+ * test declarations
+ */
+bool test_mat(void);
+
+
+/**
+ * Main entry.
+ *   @argc: The argument count.
+ *   @argv: The argument array.
+ *   &return: The exit code.
+ */
+int main(int argc, char **argv)
+{
+	bool suc = true;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	suc &= test_mat();
+
+	if(hax_memcnt != 0)
+		suc &= false, fprintf(stderr, "Error. Missed %d allocations.\n", hax_memcnt);
+
+	if(suc)
+		printf("success\n");
+	else
+		printf("=== FAIL ===\n");
+
+	return suc ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static struct rmat_expr_t *mat_new(const double *arr, unsigned int n);
+static struct rmat_sparse_t *mat_sparse(const double *arr, unsigned int n);
+static struct rvec_expr_t *vec_new(const double *arr, unsigned int n);
+static void arr_rand(struct m_rand_t *rand, double *arr, unsigned int len);
+static bool mat_ident(struct rmat_expr_t *inv, const double *arr, unsigned int n);
+static bool vec_near(struct rvec_expr_t *left, struct rvec_expr_t *right);
+static double flt(struct r_expr_t *expr);
+
+
+/**
+ * Perform tests on expression matrices with numeric entries.
+ *   &returns: Success flag.
+ */
+bool test_mat(void)
+{
+	bool suc = true;
+
+	{
+		double arr[16] = {
+			5.0 / 3.0, 2.0, -1.0 / 3.0, 0.0,
+			-1.0, 5.0 / 3.0, -8.0 / 3.0, 0.0,
+			-2.0, -1.0 / 3.0, -5.0 / 3.0, 3.0,
+			-4.0 / 3.0, 0.0, 0.0, 0.0
+		};
+		struct r_expr_t *det;
+		struct rmat_expr_t *mat, *inv;
+
+		/* an exact zero folds to rounding residue mid-elimination */
+		mat = mat_new(arr, 4);
+		det = rmat_expr_det(mat);
+		inv = rmat_expr_inv(mat);
+		suc &= chk(fabs(flt(det) + 172.0 / 9.0) < 1e-12, "mat0");
+		suc &= chk(mat_ident(inv, arr, 4), "mat1");
+		suc &= chk((fabs(flt(inv->arr[1])) < 1e-12) && (fabs(flt(inv->arr[2])) < 1e-12), "mat2");
+
+		r_expr_delete(det);
+		rmat_expr_delete(mat);
+		rmat_expr_delete(inv);
+	}
+
+	{
+		double arr[9] = { 1.0, 2.0, 3.0, 2.0, 4.0, 6.0, 1.0, 0.5, 0.25 };
+		struct r_expr_t *det;
+		struct rmat_expr_t *mat;
+
+		mat = mat_new(arr, 3);
+		det = rmat_expr_det(mat);
+		suc &= chk(r_expr_is_zero(det), "mat3");
+
+		r_expr_delete(det);
+		rmat_expr_delete(mat);
+	}
+
+	{
+		unsigned int i, n, nbad[3] = { 0, 0, 0 }, want[2];
+		double arr[36], rhs[6];
+		struct m_rand_t rand;
+		struct r_expr_t *det;
+		struct rmat_expr_t *mat, *inv;
+		struct rmat_sparse_t *sparse;
+		struct rvec_expr_t *vec, *dense, *part, *ref;
+
+		rand = m_rand_stream(21, 0);
+
+		for(i = 0; i < 2000; i++) {
+			n = 2 + m_rand_u32(&rand) % 5;
+			arr_rand(&rand, arr, n * n);
+			arr_rand(&rand, rhs, n);
+
+			mat = mat_new(arr, n);
+			det = rmat_expr_det(mat);
+
+			if(fabs(flt(det)) > 1e-6) {
+				inv = rmat_expr_inv(mat);
+				nbad[0] += !mat_ident(inv, arr, n);
+				rmat_expr_delete(inv);
+
+				vec = vec_new(rhs, n);
+				sparse = mat_sparse(arr, n);
+				want[0] = n - 1;
+				want[1] = 0;
+
+				dense = rmat_expr_solve(mat, vec, NULL, 0);
+				ref = rmat_sparse_solve(sparse, vec, NULL, 0);
+				nbad[1] += !vec_near(dense, ref);
+				rvec_expr_delete(dense);
+				rvec_expr_delete(ref);
+
+				part = rmat_expr_solve(mat, vec, want, 2);
+				ref = rmat_sparse_solve(sparse, vec, want, 2);
+				nbad[2] += !vec_near(part, ref);
+				rvec_expr_delete(part);
+				rvec_expr_delete(ref);
+
+				rmat_sparse_delete(sparse);
+				rvec_expr_delete(vec);
+			}
+
+			r_expr_delete(det);
+			rmat_expr_delete(mat);
+		}
+
+		suc &= chk(nbad[0] == 0, "mat4");
+		suc &= chk(nbad[1] == 0, "mat5");
+		suc &= chk(nbad[2] == 0, "mat6");
+	}
+
+	return suc;
+}
+
+
+/**
+ * Create an expression matrix from a row-major float array.
+ *   @arr: The array.
+ *   @n: The number of rows and columns.
+ *   &returns: The matrix.
+ */
+static struct rmat_expr_t *mat_new(const double *arr, unsigned int n)
+{
+	unsigned int i;
+	struct rmat_expr_t *mat;
+
+	mat = rmat_expr_new(n, n);
+	for(i = 0; i < (n * n); i++)
+		r_expr_set(&mat->arr[i], r_expr_flt(arr[i]));
+
+	return mat;
+}
+
+/**
+ * Create a sparse matrix from the nonzero entries of a row-major float
+ * array.
+ *   @arr: The array.
+ *   @n: The number of rows and columns.
+ *   &returns: The sparse matrix.
+ */
+static struct rmat_sparse_t *mat_sparse(const double *arr, unsigned int n)
+{
+	unsigned int i, j;
+	struct r_grad_t **iter;
+	struct rmat_sparse_t *mat;
+
+	mat = rmat_sparse_new(n, n);
+
+	for(i = 0; i < n; i++) {
+		iter = &mat->row[i];
+
+		for(j = 0; j < n; j++) {
+			if(arr[i * n + j] == 0.0)
+				continue;
+
+			*iter = malloc(sizeof(struct r_grad_t));
+			(*iter)->idx = j;
+			(*iter)->expr = r_expr_flt(arr[i * n + j]);
+			iter = &(*iter)->next;
+		}
+
+		*iter = NULL;
+	}
+
+	return mat;
+}
+
+/**
+ * Create an expression vector from a float array.
+ *   @arr: The array.
+ *   @n: The length.
+ *   &returns: The vector.
+ */
+static struct rvec_expr_t *vec_new(const double *arr, unsigned int n)
+{
+	unsigned int i;
+	struct rvec_expr_t *vec;
+
+	vec = rvec_expr_new(n);
+	for(i = 0; i < n; i++)
+		r_expr_set(&vec->arr[i], r_expr_flt(arr[i]));
+
+	return vec;
+}
+
+/**
+ * Fill an array with random thirds, a third of them zero, so that exact
+ * cancellations are common.
+ *   @rand: The random number generator.
+ *   @arr: Out. The array.
+ *   @len: The length.
+ */
+static void arr_rand(struct m_rand_t *rand, double *arr, unsigned int len)
+{
+	unsigned int i;
+
+	for(i = 0; i < len; i++)
+		arr[i] = (m_rand_u32(rand) % 3 == 0) ? 0.0 : (double)((int)(m_rand_u32(rand) % 13) - 6) / 3.0;
+}
+
+/**
+ * Check that the product of an inverse and its matrix is the identity.
+ *   @inv: The inverse.
+ *   @arr: The row-major matrix.
+ *   @n: The number of rows and columns.
+ *   &returns: True if within tolerance of the identity.
+ */
+static bool mat_ident(struct rmat_expr_t *inv, const double *arr, unsigned int n)
+{
+	unsigned int i, j, k;
+	double sum;
+
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++) {
+			sum = 0.0;
+			for(k = 0; k < n; k++)
+				sum += flt(inv->arr[i * n + k]) * arr[k * n + j];
+
+			if(!(fabs(sum - ((i == j) ? 1.0 : 0.0)) < 1e-9))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Check that two float vectors are within tolerance of each other.
+ *   @left: The left vector.
+ *   @right: The right vector.
+ *   &returns: True if near.
+ */
+static bool vec_near(struct rvec_expr_t *left, struct rvec_expr_t *right)
+{
+	unsigned int i;
+
+	for(i = 0; i < left->len; i++) {
+		if(!(fabs(flt(left->arr[i]) - flt(right->arr[i])) < (1e-9 * (1.0 + fabs(flt(right->arr[i]))))))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Retrieve the value of a float expression.
+ *   @expr: The expression.
+ *   &returns: The value, or not-a-number if not a float.
+ */
+static double flt(struct r_expr_t *expr)
+{
+	return (expr->type == r_flt_v) ? expr->data.flt : NAN;
+}
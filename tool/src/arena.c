@@ -0,0 +1,112 @@
+#include "common.h"
+
+
+/*
+ * global variables
+ */
+__thread struct fl_arena_t *fl_arena_cur = NULL;
+
+
+/**
+ * Create an arena.
+ *   &returns: The arena.
+ */
+struct fl_arena_t *fl_arena_new(void)
+{
+	struct fl_arena_t *arena;
+
+	arena = malloc(sizeof(struct fl_arena_t));
+	arena->chunk = NULL;
+	arena->ptr = arena->end = NULL;
+
+	return arena;
+}
+
+/**
+ * Delete an arena, releasing every allocation made from it.
+ *   @arena: The arena.
+ */
+void fl_arena_delete(struct fl_arena_t *arena)
+{
+	fl_arena_reset(arena, (struct fl_mark_t){ NULL, NULL });
+	free(arena);
+}
+
+
+/**
+ * Allocate memory from an arena.
+ *   @arena: The arena.
+ *   @nbytes: The number of bytes.
+ *   &returns: The allocated memory.
+ */
+void *fl_arena_alloc(struct fl_arena_t *arena, size_t nbytes)
+{
+	void *ptr;
+	size_t size;
+	struct fl_chunk_t *chunk;
+
+	nbytes = (nbytes + 15) & ~(size_t)15;
+
+	if((size_t)(arena->end - arena->ptr) < nbytes) {
+		size = (nbytes > FL_ARENA_CHUNK) ? nbytes : FL_ARENA_CHUNK;
+
+		chunk = malloc(sizeof(struct fl_chunk_t) + size);
+		chunk->next = arena->chunk;
+		chunk->end = chunk->data + size;
+
+		arena->chunk = chunk;
+		arena->ptr = chunk->data;
+		arena->end = chunk->end;
+	}
+
+	ptr = arena->ptr;
+	arena->ptr += nbytes;
+
+	return ptr;
+}
+
+
+/**
+ * Mark the current position of an arena.
+ *   @arena: The arena.
+ *   &returns: The mark.
+ */
+struct fl_mark_t fl_arena_mark(struct fl_arena_t *arena)
+{
+	return (struct fl_mark_t){ arena->chunk, arena->ptr };
+}
+
+/**
+ * Reset an arena to a mark, releasing every allocation made after it.
+ *   @arena: The arena.
+ *   @mark: The mark.
+ */
+void fl_arena_reset(struct fl_arena_t *arena, struct fl_mark_t mark)
+{
+	struct fl_chunk_t *chunk;
+
+	while(arena->chunk != mark.chunk) {
+		chunk = arena->chunk;
+		arena->chunk = chunk->next;
+		free(chunk);
+	}
+
+	arena->ptr = mark.ptr;
+	arena->end = mark.chunk ? mark.chunk->end : NULL;
+}
+
+
+/**
+ * Bind an arena to the calling thread. While bound, new expressions and
+ * functions are allocated from the arena.
+ *   @arena: Optional. The arena, or null to use the heap.
+ *   &returns: The previously bound arena.
+ */
+struct fl_arena_t *fl_arena_bind(struct fl_arena_t *arena)
+{
+	struct fl_arena_t *prev = fl_arena_cur;
+
+	fl_arena_cur = arena;
+
+	return prev;
+}
@@ -0,0 +1,60 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * arena definitions
+ */
+#define FL_ARENA_CHUNK (64 * 1024)
+
+/**
+ * Arena chunk structure.
+ *   @next: The next (older) chunk.
+ *   @end: The end of the chunk data.
+ *   @data: The data.
+ */
+struct fl_chunk_t {
+	struct fl_chunk_t *next;
+	char *end;
+
+	char data[] __attribute__((aligned(16)));
+};
+
+/**
+ * Arena structure.
+ *   @chunk: The current chunk.
+ *   @ptr, end: The allocation pointer and the end of the current chunk.
+ */
+struct fl_arena_t {
+	struct fl_chunk_t *chunk;
+	char *ptr, *end;
+};
+
+/**
+ * Arena mark structure.
+ *   @chunk: The chunk.
+ *   @ptr: The allocation pointer.
+ */
+struct fl_mark_t {
+	struct fl_chunk_t *chunk;
+	char *ptr;
+};
+
+/*
+ * arena variables
+ */
+extern __thread struct fl_arena_t *fl_arena_cur;
+
+/*
+ * arena declarations
+ */
+struct fl_arena_t *fl_arena_new(void);
+void fl_arena_delete(struct fl_arena_t *arena);
+
+void *fl_arena_alloc(struct fl_arena_t *arena, size_t nbytes);
+
+struct fl_mark_t fl_arena_mark(struct fl_arena_t *arena);
+void fl_arena_reset(struct fl_arena_t *arena, struct fl_mark_t mark);
+
+struct fl_arena_t *fl_arena_bind(struct fl_arena_t *arena);
+
+#endif
@@ -0,0 +1,334 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static bool lane_fill(struct fl_batch_t *batch, struct fl_lane_t *lane, fl_fetch_f fetch, fl_report_f report, void *arg);
+static void lane_clear(struct fl_lane_t *lane);
+static bool lane_screen(struct fl_batch_t *batch, struct fl_lane_t *lane);
+static unsigned int lane_block(struct fl_batch_t *batch, struct fl_lane_t *lane, enum fl_prec_e prec, unsigned int n);
+static void lane_check(struct fl_batch_t *batch, struct fl_lane_t *lane);
+
+
+/**
+ * Create a batch.
+ *   @nlanes: The number of lanes.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   @screen: Optional. The screen.
+ *   &returns: The batch.
+ */
+struct fl_batch_t *fl_batch_new(unsigned int nlanes, const double *in, const double *ref, unsigned int len, double tol, const struct fl_screen_t *screen)
+{
+	unsigned int i;
+	struct fl_batch_t *batch;
+
+	batch = malloc(sizeof(struct fl_batch_t));
+	batch->in = in;
+	batch->ref = ref;
+	batch->len = len;
+	batch->tol = tol;
+	batch->lane = malloc(nlanes * sizeof(struct fl_lane_t));
+	batch->nlanes = nlanes;
+
+	batch->screen = screen;
+	batch->reject = NULL;
+
+	batch->prec = fl_prec_f64_v;
+	batch->inf = batch->reff = NULL;
+
+	for(i = 0; i < nlanes; i++)
+		batch->lane[i].inst = NULL;
+
+	if(screen != NULL) {
+		batch->reject = malloc(fl_screen_nstages(screen) * sizeof(uint64_t));
+		for(i = 0; i < fl_screen_nstages(screen); i++)
+			batch->reject[i] = 0;
+	}
+
+	return batch;
+}
+
+/**
+ * Delete a batch.
+ *   @batch: The batch.
+ */
+void fl_batch_delete(struct fl_batch_t *batch)
+{
+	unsigned int i;
+
+	for(i = 0; i < batch->nlanes; i++) {
+		if(batch->lane[i].inst != NULL)
+			lane_clear(&batch->lane[i]);
+	}
+
+	if(batch->reject != NULL)
+		free(batch->reject);
+
+	free(batch->lane);
+	free(batch);
+}
+
+
+/**
+ * Select the scoring precision of a batch. The single precision signals
+ * are referenced, not copied, and must match the length of the batch.
+ *   @batch: The batch.
+ *   @prec: The precision.
+ *   @in: The single precision input signal.
+ *   @ref: The single precision reference signal.
+ */
+void fl_batch_prec(struct fl_batch_t *batch, enum fl_prec_e prec, const float *in, const float *ref)
+{
+	batch->prec = prec;
+	batch->inf = in;
+	batch->reff = ref;
+}
+
+
+/**
+ * Run the batch until the candidates are exhausted. The lanes at the lowest
+ * sample index are advanced together one block at a time, so each block of
+ * the signal is shared by every lane at that position while it is still in
+ * cache. Finished lanes are refilled immediately and catch up from the
+ * start of the signal. With a screen, candidates are first checked over
+ * intervals and then on the transient samples, or over the warm-up if
+ * stateful, and every rejection is counted against its stage. In mixed
+ * precision, candidates that match in single precision are re-checked in
+ * double precision before reporting.
+ *   @batch: The batch.
+ *   @fetch: The candidate fetch callback.
+ *   @report: The result callback.
+ *   @arg: The callback argument.
+ */
+void fl_batch_run(struct fl_batch_t *batch, fl_fetch_f fetch, fl_report_f report, void *arg)
+{
+	bool more = true;
+	unsigned int i, k, n, pos, nlive = 0;
+	struct fl_lane_t *lane;
+
+	for(i = 0; i < batch->nlanes; i++) {
+		if((batch->lane[i].inst == NULL) && more)
+			more = lane_fill(batch, &batch->lane[i], fetch, report, arg);
+
+		if(batch->lane[i].inst != NULL)
+			nlive++;
+	}
+
+	while(nlive > 0) {
+		pos = UINT_MAX;
+		for(i = 0; i < batch->nlanes; i++) {
+			if((batch->lane[i].inst != NULL) && (batch->lane[i].idx < pos))
+				pos = batch->lane[i].idx;
+		}
+
+		n = ((batch->len - pos) < FL_BLOCK) ? (batch->len - pos) : FL_BLOCK;
+
+		for(i = 0; i < batch->nlanes; i++) {
+			lane = &batch->lane[i];
+			if((lane->inst == NULL) || (lane->idx != pos))
+				continue;
+
+			k = lane_block(batch, lane, batch->prec, n);
+
+			lane->idx += k;
+			if((k == n) && (lane->idx < batch->len))
+				continue;
+
+			if((lane->idx == batch->len) && (batch->prec == fl_prec_mixed_v))
+				lane_check(batch, lane);
+
+			if((batch->screen != NULL) && (lane->idx < batch->len))
+				batch->reject[fl_screen_stage(batch->screen, lane->idx)]++;
+
+			report(lane->inst, lane->max, lane->idx, arg);
+			lane_clear(lane);
+			nlive--;
+
+			if(more && (more = lane_fill(batch, lane, fetch, report, arg)))
+				nlive++;
+		}
+	}
+}
+
+
+/**
+ * Fill a lane with the next candidate that passes the interval and
+ * transient screens.
+ *   @batch: The batch.
+ *   @lane: The lane.
+ *   @fetch: The fetch callback.
+ *   @report: The report callback, used for screened out candidates.
+ *   @arg: The callback argument.
+ *   &returns: True if filled, false if the candidates are exhausted.
+ */
+static bool lane_fill(struct fl_batch_t *batch, struct fl_lane_t *lane, fl_fetch_f fetch, fl_report_f report, void *arg)
+{
+	unsigned int i;
+	struct fl_inst_t *inst;
+
+	while(true) {
+		inst = fetch(arg);
+		if(inst == NULL)
+			return false;
+
+		if((inst->func->in != 1) || (inst->func->out != 1))
+			fatal("Batch candidates must have exactly one input and one output.");
+
+		if((batch->screen != NULL) && !fl_ival_check(inst->func, batch->screen->range, FL_IVALITERS)) {
+			batch->reject[0]++;
+			report(inst, INFINITY, 0, arg);
+			continue;
+		}
+
+		lane->inst = inst;
+		lane->prog = fl_prog_new(inst->func);
+		lane->st = malloc(inst->func->st * sizeof(double));
+		lane->stf = malloc(inst->func->st * sizeof(float));
+		lane->max = 0.0;
+		lane->idx = 0;
+
+		for(i = 0; i < inst->func->st; i++) {
+			lane->st[i] = 0.0;
+			lane->stf[i] = 0.0f;
+		}
+
+		if((batch->screen == NULL) || lane_screen(batch, lane))
+			return true;
+
+		batch->reject[1]++;
+		report(lane->inst, lane->max, lane->idx, arg);
+		lane_clear(lane);
+	}
+}
+
+/**
+ * Clear a lane.
+ *   @lane: The lane.
+ */
+static void lane_clear(struct fl_lane_t *lane)
+{
+	fl_prog_delete(lane->prog);
+	free(lane->st);
+	free(lane->stf);
+	lane->inst = NULL;
+}
+
+/**
+ * Check a lane against the transient samples of the screen. Only
+ * candidates whose outputs do not read the state can be checked out of
+ * order. Any others are run in order from the zero state over the warm-up
+ * instead, keeping their progress so the samples are not scored twice.
+ *   @batch: The batch.
+ *   @lane: The lane.
+ *   &returns: True if the candidate passes.
+ */
+static bool lane_screen(struct fl_batch_t *batch, struct fl_lane_t *lane)
+{
+	unsigned int i, k, n;
+	double out[FL_BLOCK], st[lane->prog->st + 1];
+	const struct fl_screen_t *screen = batch->screen;
+
+	if(fl_func_stateful(lane->inst->func)) {
+		while(lane->idx < screen->warm) {
+			n = ((screen->warm - lane->idx) < FL_BLOCK) ? (screen->warm - lane->idx) : FL_BLOCK;
+			k = lane_block(batch, lane, batch->prec, n);
+
+			lane->idx += k;
+			if(k < n)
+				return false;
+		}
+
+		return true;
+	}
+
+	for(i = 0; i < screen->ntrans; i += n) {
+		n = ((screen->ntrans - i) < FL_BLOCK) ? (screen->ntrans - i) : FL_BLOCK;
+		memcpy(st, lane->st, lane->prog->st * sizeof(double));
+		fl_prog_run(lane->prog, screen->in + i, out, st, n);
+
+		for(k = 0; k < n; k++) {
+			if(isnan(out[k]))
+				return false;
+
+			lane->max = fmax(fabs(out[k] - screen->ref[i + k]), lane->max);
+			if(lane->max > batch->tol)
+				return false;
+		}
+	}
+
+	lane->max = 0.0;
+
+	return true;
+}
+
+/**
+ * Advance a lane over a block of samples at its index.
+ *   @batch: The batch.
+ *   @lane: The lane.
+ *   @prec: The precision, either single or double.
+ *   @n: The number of samples.
+ *   &returns: The number of accepted samples.
+ */
+static unsigned int lane_block(struct fl_batch_t *batch, struct fl_lane_t *lane, enum fl_prec_e prec, unsigned int n)
+{
+	unsigned int k;
+	double out[FL_BLOCK];
+	float outf[FL_BLOCK];
+
+	if(prec == fl_prec_f64_v) {
+		fl_prog_run(lane->prog, batch->in + lane->idx, out, lane->st, n);
+
+		for(k = 0; k < n; k++) {
+			if(isnan(out[k]))
+				break;
+
+			lane->max = fmax(fabs(out[k] - batch->ref[lane->idx + k]), lane->max);
+			if(lane->max > batch->tol)
+				break;
+		}
+	}
+	else {
+		fl_prog_runf(lane->prog, batch->inf + lane->idx, outf, lane->stf, n);
+
+		for(k = 0; k < n; k++) {
+			if(isnan(outf[k]))
+				break;
+
+			lane->max = fmax(fabs((double)outf[k] - batch->reff[lane->idx + k]), lane->max);
+			if(lane->max > batch->tol)
+				break;
+		}
+	}
+
+	return k;
+}
+
+/**
+ * Re-check a lane that matched in single precision over the whole signal
+ * in double precision, leaving the double precision result in the lane.
+ *   @batch: The batch.
+ *   @lane: The lane.
+ */
+static void lane_check(struct fl_batch_t *batch, struct fl_lane_t *lane)
+{
+	unsigned int i, k, n;
+
+	for(i = 0; i < lane->prog->st; i++)
+		lane->st[i] = 0.0;
+
+	lane->max = 0.0;
+	lane->idx = 0;
+
+	while(lane->idx < batch->len) {
+		n = ((batch->len - lane->idx) < FL_BLOCK) ? (batch->len - lane->idx) : FL_BLOCK;
+		k = lane_block(batch, lane, fl_prec_f64_v, n);
+
+		lane->idx += k;
+		if(k < n)
+			break;
+	}
+}
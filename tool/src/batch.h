@@ -0,0 +1,90 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+ * Fetch the next candidate.
+ *   @arg: The argument.
+ *   &returns: The instance, or null if exhausted.
+ */
+typedef struct fl_inst_t *(*fl_fetch_f)(void *arg);
+
+/**
+ * Report a scored candidate.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of samples accepted, equal to the length on a match.
+ *   @arg: The argument.
+ */
+typedef void (*fl_report_f)(struct fl_inst_t *inst, double max, unsigned int idx, void *arg);
+
+
+/**
+ * Scoring precision enumerator.
+ *   @fl_prec_f64_v: Double precision.
+ *   @fl_prec_f32_v: Single precision.
+ *   @fl_prec_mixed_v: Single precision, with matches re-checked in double
+ *     precision.
+ */
+enum fl_prec_e {
+	fl_prec_f64_v,
+	fl_prec_f32_v,
+	fl_prec_mixed_v
+};
+
+/**
+ * Lane structure.
+ *   @inst: The instance, null if free.
+ *   @prog: The compiled program.
+ *   @st: The state.
+ *   @stf: The single precision state.
+ *   @max: The maximum error.
+ *   @idx: The current sample index.
+ */
+struct fl_lane_t {
+	struct fl_inst_t *inst;
+	struct fl_prog_t *prog;
+
+	double *st;
+	float *stf;
+	double max;
+	unsigned int idx;
+};
+
+/**
+ * Batch structure.
+ *   @in, ref: The input and reference signals.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   @lane: The lane array.
+ *   @nlanes: The number of lanes.
+ *   @screen: Optional. The screen.
+ *   @reject: The per-stage rejection counts when screening.
+ *   @prec: The scoring precision.
+ *   @inf, reff: The single precision input and reference signals.
+ */
+struct fl_batch_t {
+	const double *in, *ref;
+	unsigned int len;
+	double tol;
+
+	struct fl_lane_t *lane;
+	unsigned int nlanes;
+
+	const struct fl_screen_t *screen;
+	uint64_t *reject;
+
+	enum fl_prec_e prec;
+	const float *inf, *reff;
+};
+
+/*
+ * batch declarations
+ */
+struct fl_batch_t *fl_batch_new(unsigned int nlanes, const double *in, const double *ref, unsigned int len, double tol, const struct fl_screen_t *screen);
+void fl_batch_delete(struct fl_batch_t *batch);
+
+void fl_batch_prec(struct fl_batch_t *batch, enum fl_prec_e prec, const float *in, const float *ref);
+
+void fl_batch_run(struct fl_batch_t *batch, fl_fetch_f fetch, fl_report_f report, void *arg);
+
+#endif
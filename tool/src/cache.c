@@ -0,0 +1,258 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static void cache_index(struct fl_cache_t *cache);
+static uint32_t cache_check(const struct fl_crec_t *rec);
+static int cache_cmp(const void *left, const void *right);
+
+
+/**
+ * Open a persistent fitness cache, creating the file if needed. The file
+ * is a flat sequence of records that is only ever appended to, so it can
+ * be shared between concurrent processes. It is mapped once with enough
+ * address space reserved for it to grow, and the index points directly
+ * into the mapping. The index is split into shards with their own locks,
+ * so lookups never wait on writers or on each other.
+ *   @cache: Out. The cache.
+ *   @path: The path.
+ *   &returns: Error.
+ */
+char *fl_cache_open(struct fl_cache_t **cache, const char *path)
+{
+	int fd;
+	void *map;
+	unsigned int i;
+
+	fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if(fd < 0)
+		return mprintf("Failed to open cache '%s'. %s.", path, strerror(errno));
+
+	map = mmap(NULL, FL_CACHE_RESERVE, PROT_READ, MAP_SHARED | MAP_NORESERVE, fd, 0);
+	if(map == MAP_FAILED) {
+		close(fd);
+		return mprintf("Failed to map cache '%s'. %s.", path, strerror(errno));
+	}
+
+	*cache = malloc(sizeof(struct fl_cache_t));
+	(*cache)->fd = fd;
+	(*cache)->map = map;
+	(*cache)->off = 0;
+	(*cache)->sync = sys_mutex_init(0);
+
+	for(i = 0; i < FL_CACHE_SHARDS; i++) {
+		(*cache)->shard[i].lock = sys_mutex_init(0);
+		(*cache)->shard[i].set = hashset_init(cache_cmp, delete_noop);
+	}
+
+	cache_index(*cache);
+
+	return NULL;
+}
+
+/**
+ * Close a cache.
+ *   @cache: The cache.
+ */
+void fl_cache_close(struct fl_cache_t *cache)
+{
+	unsigned int i;
+
+	for(i = 0; i < FL_CACHE_SHARDS; i++) {
+		hashset_destroy(&cache->shard[i].set);
+		sys_mutex_destroy(&cache->shard[i].lock);
+	}
+
+	sys_mutex_destroy(&cache->sync);
+	munmap((void *)cache->map, FL_CACHE_RESERVE);
+	close(cache->fd);
+	free(cache);
+}
+
+
+/**
+ * Index any records appended to a cache since the last synchronization,
+ * including those from other processes.
+ *   @cache: The cache.
+ */
+void fl_cache_sync(struct fl_cache_t *cache)
+{
+	sys_mutex_lock(&cache->sync);
+	cache_index(cache);
+	sys_mutex_unlock(&cache->sync);
+}
+
+/**
+ * Look up a scored candidate in a cache. Only the shard of the key is
+ * locked, and only for the lookup itself.
+ *   @cache: The cache.
+ *   @hash: The instance hash.
+ *   @sig: The signal fingerprint.
+ *   @max: Out. The maximum error.
+ *   @idx: Out. The number of samples accepted.
+ *   &returns: True on a hit.
+ */
+bool fl_cache_get(struct fl_cache_t *cache, uint64_t hash, uint64_t sig, double *max, unsigned int *idx)
+{
+	uint64_t key;
+	const struct fl_crec_t *rec;
+	struct fl_cshard_t *shard;
+	struct fl_crec_t cmp = { .hash = hash, .sig = sig };
+
+	key = mash64(hash, sig);
+	shard = &cache->shard[(key >> 32) % FL_CACHE_SHARDS];
+
+	sys_mutex_lock(&shard->lock);
+	rec = hashset_lookup(&shard->set, key, &cmp);
+	sys_mutex_unlock(&shard->lock);
+
+	if(rec == NULL)
+		return false;
+
+	*max = rec->max;
+	*idx = rec->idx;
+
+	return true;
+}
+
+/**
+ * Queue a scored candidate for a cache in the append buffer of a writer,
+ * flushing the buffer once it is full.
+ *   @cache: The cache.
+ *   @buf: The append buffer.
+ *   @hash: The instance hash.
+ *   @sig: The signal fingerprint.
+ *   @max: The maximum error.
+ *   @idx: The number of samples accepted.
+ */
+void fl_cache_put(struct fl_cache_t *cache, struct fl_cbuf_t *buf, uint64_t hash, uint64_t sig, double max, unsigned int idx)
+{
+	struct fl_crec_t *rec = &buf->rec[buf->len++];
+
+	*rec = (struct fl_crec_t){ hash, sig, max, idx, 0 };
+	rec->check = cache_check(rec);
+
+	if(buf->len == FL_CACHE_BATCH)
+		fl_cache_flush(cache, buf);
+}
+
+/**
+ * Flush the append buffer of a writer to a cache. The records are written
+ * with a single append, so concurrent writers never interleave within a
+ * record and need no lock. New records are then indexed, unless another
+ * writer is already indexing, in which case they are picked up by the next
+ * synchronization.
+ *   @cache: The cache.
+ *   @buf: The append buffer.
+ */
+void fl_cache_flush(struct fl_cache_t *cache, struct fl_cbuf_t *buf)
+{
+	size_t nbytes = buf->len * sizeof(struct fl_crec_t);
+
+	if(buf->len == 0)
+		return;
+
+	if(write(cache->fd, buf->rec, nbytes) != (ssize_t)nbytes)
+		fatal("Failed to write cache records. %s.", strerror(errno));
+
+	buf->len = 0;
+
+	if(sys_mutex_trylock(&cache->sync)) {
+		cache_index(cache);
+		sys_mutex_unlock(&cache->sync);
+	}
+}
+
+
+/**
+ * Compute the fingerprint of a scoring problem. Candidates are only
+ * shared between runs with the same fingerprint.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   &returns: The fingerprint.
+ */
+uint64_t fl_cache_sig(const double *in, const double *ref, unsigned int len, double tol)
+{
+	uint64_t sig = FL_CACHE_MAGIC;
+
+	sig = mash64(sig, len);
+	mash64buf(&sig, &tol, sizeof(double));
+	mash64buf(&sig, (void *)in, len * sizeof(double));
+	mash64buf(&sig, (void *)ref, len * sizeof(double));
+
+	return sig;
+}
+
+
+/**
+ * Index the complete records past the indexed offset. A record that fails
+ * its check was torn by an interrupted append, so the scan resynchronizes
+ * by advancing one byte at a time until the next valid record. The
+ * indexing lock must be held.
+ *   @cache: The cache.
+ */
+static void cache_index(struct fl_cache_t *cache)
+{
+	uint64_t key;
+	struct stat info;
+	struct fl_cshard_t *shard;
+	const struct fl_crec_t *rec;
+
+	if(fstat(cache->fd, &info) < 0)
+		fatal("Failed to stat cache. %s.", strerror(errno));
+
+	if((size_t)info.st_size > FL_CACHE_RESERVE)
+		fatal("Cache exceeds the reserved mapping.");
+
+	while((cache->off + sizeof(struct fl_crec_t)) <= (size_t)info.st_size) {
+		rec = (const struct fl_crec_t *)(cache->map + cache->off);
+		if(rec->check != cache_check(rec)) {
+			cache->off++;
+			continue;
+		}
+
+		cache->off += sizeof(struct fl_crec_t);
+
+		key = mash64(rec->hash, rec->sig);
+		shard = &cache->shard[(key >> 32) % FL_CACHE_SHARDS];
+
+		sys_mutex_lock(&shard->lock);
+		hashset_insert(&shard->set, key, (void *)rec);
+		sys_mutex_unlock(&shard->lock);
+	}
+}
+
+/**
+ * Compute the check of a record.
+ *   @rec: The record.
+ *   &returns: The check.
+ */
+static uint32_t cache_check(const struct fl_crec_t *rec)
+{
+	double max = rec->max;
+	uint64_t check = FL_CACHE_MAGIC;
+
+	check = mash64(check, rec->hash);
+	check = mash64(check, rec->sig);
+	mash64buf(&check, &max, sizeof(double));
+	check = mash64(check, rec->idx);
+
+	return check ^ (check >> 32);
+}
+
+/**
+ * Compare two records by key.
+ *   @left: The left record.
+ *   @right: The right record.
+ *   &returns: Zero if equal.
+ */
+static int cache_cmp(const void *left, const void *right)
+{
+	const struct fl_crec_t *a = left, *b = right;
+
+	return (a->hash != b->hash) || (a->sig != b->sig);
+}
@@ -0,0 +1,77 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+/*
+ * cache definitions
+ */
+#define FL_CACHE_MAGIC 0x464c4341u
+#define FL_CACHE_RESERVE ((size_t)1 << 36)
+#define FL_CACHE_SHARDS 64
+#define FL_CACHE_BATCH 64
+
+/**
+ * Cache record structure, as stored on disk. Packed, since the records
+ * following a torn append are no longer aligned in the file.
+ *   @hash: The instance hash.
+ *   @sig: The signal fingerprint.
+ *   @max: The maximum error.
+ *   @idx: The number of samples accepted.
+ *   @check: The record check, used to find torn records.
+ */
+struct fl_crec_t {
+	uint64_t hash, sig;
+	double max;
+	uint32_t idx, check;
+} __attribute__((packed));
+
+/**
+ * Cache append buffer, one per writer.
+ *   @rec: The pending records.
+ *   @len: The number of pending records.
+ */
+struct fl_cbuf_t {
+	struct fl_crec_t rec[FL_CACHE_BATCH];
+	unsigned int len;
+};
+
+/**
+ * Cache index shard structure.
+ *   @lock: The lock.
+ *   @set: The record index.
+ */
+struct fl_cshard_t {
+	sys_mutex_t lock;
+	struct hashset_t set;
+};
+
+/**
+ * Cache structure.
+ *   @fd: The file descriptor.
+ *   @map: The mapping, reserved large enough for the file to grow.
+ *   @off: The number of bytes indexed.
+ *   @sync: The indexing lock.
+ *   @shard: The record index shards.
+ */
+struct fl_cache_t {
+	int fd;
+	const uint8_t *map;
+	size_t off;
+
+	sys_mutex_t sync;
+	struct fl_cshard_t shard[FL_CACHE_SHARDS];
+};
+
+/*
+ * cache declarations
+ */
+char *fl_cache_open(struct fl_cache_t **cache, const char *path);
+void fl_cache_close(struct fl_cache_t *cache);
+
+void fl_cache_sync(struct fl_cache_t *cache);
+bool fl_cache_get(struct fl_cache_t *cache, uint64_t hash, uint64_t sig, double *max, unsigned int *idx);
+void fl_cache_put(struct fl_cache_t *cache, struct fl_cbuf_t *buf, uint64_t hash, uint64_t sig, double max, unsigned int idx);
+void fl_cache_flush(struct fl_cache_t *cache, struct fl_cbuf_t *buf);
+
+uint64_t fl_cache_sig(const double *in, const double *ref, unsigned int len, double tol);
+
+#endif
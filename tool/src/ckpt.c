@@ -0,0 +1,840 @@
+#include "common.h"
+
+
+/**
+ * Record reader.
+ *   @ptr, end: The current and end pointers.
+ */
+struct rd_t {
+	const uint8_t *ptr, *end;
+};
+
+/*
+ * local declarations
+ */
+static char *ckpt_open(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_gen_t *gen, struct m_rand_t *rand, uint64_t *ntrials, struct fl_search_t *search);
+static char *ckpt_load(struct fl_ckpt_t *ckpt, const uint8_t *map, size_t size, size_t *off);
+static char *ckpt_write(int fd, const struct fl_buf_t *buf);
+static char *ckpt_replace(struct fl_ckpt_t *ckpt, const struct fl_buf_t *buf);
+
+static unsigned int ckpt_len(const struct fl_ckpt_t *ckpt);
+static struct fl_inst_t *ckpt_get(const struct fl_ckpt_t *ckpt, unsigned int idx);
+static uint64_t *ckpt_nevict(const struct fl_ckpt_t *ckpt);
+static unsigned int ckpt_groups(const struct fl_ckpt_t *ckpt);
+static struct bloom_t **ckpt_seen(const struct fl_ckpt_t *ckpt, unsigned int grp, unsigned int **nseen);
+
+static void enc_seen(struct fl_buf_t *buf, const struct fl_ckpt_t *ckpt);
+static void enc_expr(struct fl_buf_t *buf, const struct fl_expr_t *expr);
+static struct fl_inst_t *dec_inst(struct rd_t *rd);
+static bool dec_seen(struct rd_t *rd, struct fl_ckpt_t *ckpt);
+static struct fl_expr_t *dec_expr(struct rd_t *rd, const struct fl_func_t *func, unsigned int tmp);
+
+static bool rd_get(struct rd_t *rd, void *ptr, size_t nbytes);
+
+
+/**
+ * Open a checkpoint of a generator, resuming from its contents if it
+ * exists. The file is mapped and its records are bulk loaded into the
+ * generator, rebuilding the duplicate detection set, and the random state
+ * and trial count are restored from the last save. The population,
+ * scores, and filters of evicted hashes are restored as of the last save,
+ * so a generator should be capped before opening. A torn record at the
+ * end, left by a crash during a save, is discarded.
+ *   @ckpt: Out. The checkpoint.
+ *   @path: The path.
+ *   @period: The minimum time between polled saves in microseconds.
+ *   @gen: The generator.
+ *   @rand: Optional. The random number generator.
+ *   @ntrials: Optional. The trial count.
+ *   &returns: Error.
+ */
+char *fl_ckpt_open(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_gen_t *gen, struct m_rand_t *rand, uint64_t *ntrials)
+{
+	return ckpt_open(ckpt, path, period, gen, rand, ntrials, NULL);
+}
+
+/**
+ * Open a checkpoint of a search, resuming from its contents if it exists.
+ * The population, constants, worker random streams, and trial count are
+ * restored as of the last save, so a resumed search continues where it
+ * stopped. The search should be capped before opening, and must not be
+ * running while the checkpoint is opened or saved.
+ *   @ckpt: Out. The checkpoint.
+ *   @path: The path.
+ *   @period: The minimum time between polled saves in microseconds.
+ *   @search: The search.
+ *   &returns: Error.
+ */
+char *fl_ckpt_open_search(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_search_t *search)
+{
+	return ckpt_open(ckpt, path, period, NULL, NULL, NULL, search);
+}
+
+/**
+ * Close a checkpoint.
+ *   @ckpt: The checkpoint.
+ */
+void fl_ckpt_close(struct fl_ckpt_t *ckpt)
+{
+	close(ckpt->fd);
+	free(ckpt->path);
+	free(ckpt);
+}
+
+
+/**
+ * Save the generator or search of a checkpoint. Only the constants and
+ * instances added since the last save are written, followed by the random
+ * state and trial count, all in a single append. Instances are written
+ * with their scores, so they should be scored before saving. If instances
+ * were evicted since the last save, a complete snapshot with the filters
+ * of evicted hashes is written to a temporary file instead and renamed
+ * over the checkpoint, so the file stays proportional to the population.
+ *   @ckpt: The checkpoint.
+ *   &returns: Error.
+ */
+char *fl_ckpt_save(struct fl_ckpt_t *ckpt)
+{
+	char *err;
+	bool snap;
+	uint32_t cnt = 0, first;
+	unsigned int i, start, len, nvals, nrands = 0;
+	uint64_t seq, nevict, *ntrials;
+	const double *val;
+	const struct m_rand_t *rand;
+	struct fl_buf_t out = { malloc(0), 0, 0 }, data = { malloc(0), 0, 0 };
+
+	if(ckpt->gen != NULL) {
+		val = ckpt->gen->val;
+		nvals = ckpt->gen->nvals;
+		seq = ckpt->gen->seq;
+		rand = ckpt->rand;
+		nrands = (rand != NULL) ? 1 : 0;
+		ntrials = ckpt->ntrials;
+	}
+	else {
+		val = ckpt->search->val;
+		nvals = ckpt->search->nvals;
+		seq = ckpt->search->seq;
+		rand = ckpt->search->rand;
+		nrands = ckpt->search->nrands;
+		ntrials = &ckpt->search->ntrials;
+	}
+
+	len = ckpt_len(ckpt);
+	nevict = *ckpt_nevict(ckpt);
+	snap = (nevict != ckpt->nevict);
+	first = snap ? 0 : ckpt->nvals;
+
+	if(nvals > first) {
+		fl_buf_put(&data, &first, sizeof(uint32_t));
+		fl_buf_put(&data, val + first, (nvals - first) * sizeof(double));
+		fl_ckpt_rec(&out, fl_ckpt_val_v, &data);
+	}
+
+	i = len;
+	while((i > 0) && (ckpt_get(ckpt, i - 1)->seq >= ckpt->seq))
+		i--;
+
+	if(snap) {
+		data.len = 0;
+		fl_ckpt_rec(&out, fl_ckpt_reset_v, &data);
+		i = 0;
+	}
+
+	for(start = i; i < len; start = i) {
+		data.len = 0;
+		fl_buf_put(&data, &cnt, sizeof(uint32_t));
+
+		while((i < len) && (data.len < FL_CKPT_CHUNK))
+			fl_ckpt_enc(&data, ckpt_get(ckpt, i++));
+
+		cnt = i - start;
+		memcpy(data.arr, &cnt, sizeof(uint32_t));
+		fl_ckpt_rec(&out, fl_ckpt_func_v, &data);
+	}
+
+	if(snap) {
+		data.len = 0;
+		enc_seen(&data, ckpt);
+		fl_ckpt_rec(&out, fl_ckpt_seen_v, &data);
+	}
+
+	if(nrands > 0) {
+		data.len = 0;
+		fl_buf_put(&data, rand, nrands * sizeof(struct m_rand_t));
+		fl_ckpt_rec(&out, fl_ckpt_rand_v, &data);
+	}
+
+	if(ntrials != NULL) {
+		data.len = 0;
+		fl_buf_put(&data, ntrials, sizeof(uint64_t));
+		fl_ckpt_rec(&out, fl_ckpt_trial_v, &data);
+	}
+
+	err = snap ? ckpt_replace(ckpt, &out) : ckpt_write(ckpt->fd, &out);
+	if(err == NULL) {
+		ckpt->nvals = nvals;
+		ckpt->seq = seq;
+		ckpt->nevict = nevict;
+		ckpt->last = sys_utime();
+	}
+
+	free(out.arr);
+	free(data.arr);
+
+	return err;
+}
+
+/**
+ * Save the generator or search of a checkpoint if the save period has
+ * elapsed.
+ *   @ckpt: The checkpoint.
+ *   &returns: Error.
+ */
+char *fl_ckpt_poll(struct fl_ckpt_t *ckpt)
+{
+	if((sys_utime() - ckpt->last) < ckpt->period)
+		return NULL;
+
+	return fl_ckpt_save(ckpt);
+}
+
+
+/**
+ * Append bytes to a buffer.
+ *   @buf: The buffer.
+ *   @ptr: The bytes.
+ *   @nbytes: The number of bytes.
+ */
+void fl_buf_put(struct fl_buf_t *buf, const void *ptr, size_t nbytes)
+{
+	if((buf->len + nbytes) > buf->cap) {
+		buf->cap = 2 * (buf->len + nbytes);
+		buf->arr = realloc(buf->arr, buf->cap);
+	}
+
+	memcpy(buf->arr + buf->len, ptr, nbytes);
+	buf->len += nbytes;
+}
+
+
+/**
+ * Append a record to a buffer.
+ *   @out: The output buffer.
+ *   @tag: The tag.
+ *   @data: The payload.
+ */
+void fl_ckpt_rec(struct fl_buf_t *out, enum fl_ckpt_e tag, const struct fl_buf_t *data)
+{
+	struct fl_chdr_t hdr;
+
+	hdr.tag = tag;
+	hdr.len = data->len;
+	hdr.check = fl_ckpt_check(hdr.tag, hdr.len, data->arr);
+
+	fl_buf_put(out, &hdr, sizeof(struct fl_chdr_t));
+	fl_buf_put(out, data->arr, data->len);
+}
+
+/**
+ * Compute the check of a record.
+ *   @tag: The tag.
+ *   @len: The payload length.
+ *   @data: The payload.
+ *   &returns: The check.
+ */
+uint64_t fl_ckpt_check(uint32_t tag, uint32_t len, const void *data)
+{
+	uint64_t check;
+
+	check = mash64(FL_CKPT_MAGIC, ((uint64_t)tag << 32) | len);
+	mash64buf(&check, (void *)data, len);
+
+	return check;
+}
+
+
+/**
+ * Encode an instance as its score and function.
+ *   @buf: The buffer.
+ *   @inst: The instance.
+ */
+void fl_ckpt_enc(struct fl_buf_t *buf, const struct fl_inst_t *inst)
+{
+	unsigned int i;
+	const struct fl_func_t *func = inst->func;
+	uint32_t hdr[5] = { inst->idx, func->in, func->tmp, func->out, func->st };
+
+	fl_buf_put(buf, &inst->max, sizeof(double));
+	fl_buf_put(buf, hdr, sizeof(hdr));
+
+	for(i = 0; i < func->tmp; i++)
+		enc_expr(buf, func->let[i]);
+
+	for(i = 0; i < func->out; i++)
+		enc_expr(buf, func->ret[i]);
+
+	for(i = 0; i < func->st; i++)
+		enc_expr(buf, func->next[i]);
+}
+
+/**
+ * Decode an instance.
+ *   @ptr: Ref. The read pointer, advanced past the instance.
+ *   @end: The end pointer.
+ *   &returns: The scored instance, or null if invalid.
+ */
+struct fl_inst_t *fl_ckpt_dec(const uint8_t **ptr, const uint8_t *end)
+{
+	struct rd_t rd = { *ptr, end };
+	struct fl_inst_t *inst;
+
+	inst = dec_inst(&rd);
+	*ptr = rd.ptr;
+
+	return inst;
+}
+
+
+/**
+ * Open a checkpoint, loading it into either a generator or a search.
+ *   @ckpt: Out. The checkpoint.
+ *   @path: The path.
+ *   @period: The minimum time between polled saves in microseconds.
+ *   @gen: The generator, or null for a search.
+ *   @rand: Optional. The random number generator of the generator.
+ *   @ntrials: Optional. The trial count of the generator.
+ *   @search: The search, or null for a generator.
+ *   &returns: Error.
+ */
+static char *ckpt_open(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_gen_t *gen, struct m_rand_t *rand, uint64_t *ntrials, struct fl_search_t *search)
+{
+	int fd;
+	void *map;
+	size_t off = 0;
+	struct stat info;
+	char *err;
+
+	fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if(fd < 0)
+		return mprintf("Failed to open checkpoint '%s'. %s.", path, strerror(errno));
+
+	if(fstat(fd, &info) < 0) {
+		close(fd);
+		return mprintf("Failed to stat checkpoint '%s'. %s.", path, strerror(errno));
+	}
+
+	*ckpt = malloc(sizeof(struct fl_ckpt_t));
+	(*ckpt)->fd = fd;
+	(*ckpt)->path = strdup(path);
+	(*ckpt)->gen = gen;
+	(*ckpt)->rand = rand;
+	(*ckpt)->ntrials = ntrials;
+	(*ckpt)->search = search;
+	(*ckpt)->nvals = 0;
+	(*ckpt)->seq = (*ckpt)->nevict = 0;
+	(*ckpt)->period = period;
+	(*ckpt)->last = sys_utime();
+
+	if(info.st_size == 0)
+		return NULL;
+
+	map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(map == MAP_FAILED) {
+		err = mprintf("Failed to map checkpoint '%s'. %s.", path, strerror(errno));
+		fl_ckpt_close(*ckpt);
+		return err;
+	}
+
+	err = ckpt_load(*ckpt, map, info.st_size, &off);
+	munmap(map, info.st_size);
+
+	if((err == NULL) && (off == 0))
+		err = mprintf("File '%s' is not a checkpoint.", path);
+
+	if((err == NULL) && (off < (size_t)info.st_size) && (ftruncate(fd, off) < 0))
+		err = mprintf("Failed to truncate checkpoint '%s'. %s.", path, strerror(errno));
+
+	if(err != NULL)
+		fl_ckpt_close(*ckpt);
+
+	return err;
+}
+
+/**
+ * Load the valid records of a mapped checkpoint. Constant records start at
+ * a fixed index, so constants added before opening are replaced rather
+ * than duplicated.
+ *   @ckpt: The checkpoint.
+ *   @map: The mapping.
+ *   @size: The mapping size.
+ *   @off: Out. The end offset of the valid records.
+ *   &returns: Error.
+ */
+static char *ckpt_load(struct fl_ckpt_t *ckpt, const uint8_t *map, size_t size, size_t *off)
+{
+	uint32_t i, cnt, first;
+	double val;
+	struct rd_t rd;
+	struct fl_chdr_t hdr;
+	struct fl_inst_t *inst;
+	struct fl_gen_t *gen = ckpt->gen;
+	struct fl_search_t *search = ckpt->search;
+	bool vals = false, funcs = false;
+
+	while((*off + sizeof(struct fl_chdr_t)) <= size) {
+		memcpy(&hdr, map + *off, sizeof(struct fl_chdr_t));
+		if((hdr.len > (size - *off - sizeof(struct fl_chdr_t))) || (hdr.check != fl_ckpt_check(hdr.tag, hdr.len, map + *off + sizeof(struct fl_chdr_t))))
+			break;
+
+		rd.ptr = map + *off + sizeof(struct fl_chdr_t);
+		rd.end = rd.ptr + hdr.len;
+
+		switch(hdr.tag) {
+		case fl_ckpt_val_v:
+			if(!rd_get(&rd, &first, sizeof(uint32_t)))
+				return mprintf("Corrupt checkpoint record.");
+
+			if(gen != NULL) {
+				gen->nvals = (first < gen->nvals) ? first : gen->nvals;
+				while(rd_get(&rd, &val, sizeof(double)))
+					fl_gen_const(gen, val);
+			}
+			else {
+				search->nvals = (first < search->nvals) ? first : search->nvals;
+				while(rd_get(&rd, &val, sizeof(double)))
+					fl_search_const(search, val);
+			}
+
+			vals = true;
+			break;
+
+		case fl_ckpt_func_v:
+			if(!rd_get(&rd, &cnt, sizeof(uint32_t)))
+				return mprintf("Corrupt checkpoint record.");
+
+			for(i = 0; i < cnt; i++) {
+				inst = dec_inst(&rd);
+				if(inst == NULL)
+					return mprintf("Corrupt checkpoint function.");
+
+				if(search != NULL)
+					fl_search_add(search, inst);
+				else if(hashset_lookup(&gen->set, inst->hash, inst) != NULL)
+					fl_inst_delete(inst);
+				else
+					fl_gen_add(gen, inst);
+			}
+
+			funcs = true;
+			break;
+
+		case fl_ckpt_rand_v:
+			if(search != NULL) {
+				search->nrands = hdr.len / sizeof(struct m_rand_t);
+				search->rand = realloc(search->rand, search->nrands * sizeof(struct m_rand_t));
+				rd_get(&rd, search->rand, search->nrands * sizeof(struct m_rand_t));
+			}
+			else if(ckpt->rand != NULL)
+				rd_get(&rd, ckpt->rand, sizeof(struct m_rand_t));
+
+			break;
+
+		case fl_ckpt_reset_v:
+			if(search != NULL)
+				fl_search_clear(search);
+			else
+				fl_gen_clear(gen);
+
+			break;
+
+		case fl_ckpt_seen_v:
+			if(!dec_seen(&rd, ckpt))
+				return mprintf("Corrupt checkpoint filter.");
+
+			break;
+
+		case fl_ckpt_trial_v:
+			if(search != NULL)
+				rd_get(&rd, &search->ntrials, sizeof(uint64_t));
+			else if(ckpt->ntrials != NULL)
+				rd_get(&rd, ckpt->ntrials, sizeof(uint64_t));
+
+			break;
+
+		default:
+			return mprintf("Unknown checkpoint record %u.", hdr.tag);
+		}
+
+		*off += sizeof(struct fl_chdr_t) + hdr.len;
+	}
+
+	ckpt->nvals = vals ? ((search != NULL) ? search->nvals : gen->nvals) : 0;
+	ckpt->seq = funcs ? ((search != NULL) ? search->seq : gen->seq) : 0;
+	ckpt->nevict = *ckpt_nevict(ckpt);
+
+	return NULL;
+}
+
+/**
+ * Write a buffer to the end of a checkpoint file and flush it to disk.
+ *   @fd: The file descriptor.
+ *   @buf: The buffer.
+ *   &returns: Error.
+ */
+static char *ckpt_write(int fd, const struct fl_buf_t *buf)
+{
+	ssize_t ret;
+	size_t off = 0;
+
+	while(off < buf->len) {
+		ret = write(fd, buf->arr + off, buf->len - off);
+		if(ret < 0) {
+			if(errno == EINTR)
+				continue;
+
+			return mprintf("Failed to write checkpoint. %s.", strerror(errno));
+		}
+
+		off += ret;
+	}
+
+	if(fdatasync(fd) < 0)
+		return mprintf("Failed to sync checkpoint. %s.", strerror(errno));
+
+	return NULL;
+}
+
+/**
+ * Replace a checkpoint with a buffer. The buffer is written to a temporary
+ * file next to the checkpoint and renamed over it, so a crash leaves either
+ * the old or the new checkpoint intact. Later saves append to the new file.
+ *   @ckpt: The checkpoint.
+ *   @buf: The buffer.
+ *   &returns: Error.
+ */
+static char *ckpt_replace(struct fl_ckpt_t *ckpt, const struct fl_buf_t *buf)
+{
+	int fd;
+	char *err, *tmp;
+
+	tmp = mprintf("%s.tmp", ckpt->path);
+	fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if(fd < 0) {
+		err = mprintf("Failed to open checkpoint '%s'. %s.", tmp, strerror(errno));
+		free(tmp);
+		return err;
+	}
+
+	err = ckpt_write(fd, buf);
+	if((err == NULL) && (rename(tmp, ckpt->path) < 0))
+		err = mprintf("Failed to replace checkpoint '%s'. %s.", ckpt->path, strerror(errno));
+
+	if(err != NULL) {
+		close(fd);
+		unlink(tmp);
+	}
+	else {
+		close(ckpt->fd);
+		ckpt->fd = fd;
+	}
+
+	free(tmp);
+
+	return err;
+}
+
+
+/**
+ * Retrieve the population size of a checkpoint.
+ *   @ckpt: The checkpoint.
+ *   &returns: The number of instances.
+ */
+static unsigned int ckpt_len(const struct fl_ckpt_t *ckpt)
+{
+	return (ckpt->gen != NULL) ? ckpt->gen->len : ckpt->search->npop;
+}
+
+/**
+ * Retrieve an instance from the population of a checkpoint.
+ *   @ckpt: The checkpoint.
+ *   @idx: The index.
+ *   &returns: The instance.
+ */
+static struct fl_inst_t *ckpt_get(const struct fl_ckpt_t *ckpt, unsigned int idx)
+{
+	return (ckpt->gen != NULL) ? ckpt->gen->arr[idx] : fl_search_get(ckpt->search, idx);
+}
+
+/**
+ * Retrieve the eviction count of a checkpoint.
+ *   @ckpt: The checkpoint.
+ *   &returns: The eviction count.
+ */
+static uint64_t *ckpt_nevict(const struct fl_ckpt_t *ckpt)
+{
+	return (ckpt->gen != NULL) ? &ckpt->gen->nevict : &ckpt->search->nevict;
+}
+
+/**
+ * Retrieve the number of evicted hash filter groups of a checkpoint, one
+ * for a generator and one per shard for a search.
+ *   @ckpt: The checkpoint.
+ *   &returns: The number of groups.
+ */
+static unsigned int ckpt_groups(const struct fl_ckpt_t *ckpt)
+{
+	return (ckpt->gen != NULL) ? 1 : FL_SHARDS;
+}
+
+/**
+ * Retrieve an evicted hash filter group of a checkpoint.
+ *   @ckpt: The checkpoint.
+ *   @grp: The group.
+ *   @nseen: Out. The number of filters.
+ *   &returns: The filter array.
+ */
+static struct bloom_t **ckpt_seen(const struct fl_ckpt_t *ckpt, unsigned int grp, unsigned int **nseen)
+{
+	if(ckpt->gen != NULL) {
+		*nseen = &ckpt->gen->nseen;
+		return &ckpt->gen->seen;
+	}
+
+	*nseen = &ckpt->search->shard[grp].nseen;
+	return &ckpt->search->shard[grp].seen;
+}
+
+
+/**
+ * Encode an expression in prefix order.
+ *   @buf: The buffer.
+ *   @expr: The expression.
+ */
+static void enc_expr(struct fl_buf_t *buf, const struct fl_expr_t *expr)
+{
+	uint8_t type = expr->type;
+	uint32_t id;
+
+	fl_buf_put(buf, &type, sizeof(uint8_t));
+
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		id = expr->data.id;
+		fl_buf_put(buf, &id, sizeof(uint32_t));
+		break;
+
+	case fl_flt_v:
+		fl_buf_put(buf, &expr->data.flt, sizeof(double));
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		enc_expr(buf, expr->data.op2.left);
+		enc_expr(buf, expr->data.op2.right);
+		break;
+	}
+}
+
+/**
+ * Encode the evicted hash filters of a checkpoint, group by group.
+ *   @buf: The buffer.
+ *   @ckpt: The checkpoint.
+ */
+static void enc_seen(struct fl_buf_t *buf, const struct fl_ckpt_t *ckpt)
+{
+	unsigned int i, j, *nseen;
+	uint32_t n;
+	uint64_t hdr[3];
+	struct bloom_t *seen;
+
+	n = ckpt_groups(ckpt);
+	fl_buf_put(buf, ckpt_nevict(ckpt), sizeof(uint64_t));
+	fl_buf_put(buf, &n, sizeof(uint32_t));
+
+	for(i = 0; i < ckpt_groups(ckpt); i++) {
+		seen = *ckpt_seen(ckpt, i, &nseen);
+		n = *nseen;
+		fl_buf_put(buf, &n, sizeof(uint32_t));
+
+		for(j = 0; j < *nseen; j++) {
+			hdr[0] = seen[j].mask + 1;
+			hdr[1] = seen[j].k;
+			hdr[2] = seen[j].count;
+			fl_buf_put(buf, hdr, sizeof(hdr));
+			fl_buf_put(buf, seen[j].bits, hdr[0] / 8);
+		}
+	}
+}
+
+/**
+ * Decode an instance.
+ *   @rd: The reader.
+ *   &returns: The scored instance, or null if invalid.
+ */
+static struct fl_inst_t *dec_inst(struct rd_t *rd)
+{
+	unsigned int i;
+	double max;
+	uint32_t hdr[5];
+	struct fl_expr_t *expr;
+	struct fl_func_t *func;
+	struct fl_inst_t *inst;
+
+	if(!rd_get(rd, &max, sizeof(double)) || !rd_get(rd, hdr, sizeof(hdr)))
+		return NULL;
+
+	func = fl_func_new(hdr[1], hdr[3], hdr[4]);
+
+	for(i = 0; i < hdr[2]; i++) {
+		if((expr = dec_expr(rd, func, hdr[2])) == NULL)
+			return fl_func_delete(func), NULL;
+
+		fl_func_tmp(func, expr);
+	}
+
+	for(i = 0; i < func->out; i++) {
+		if((expr = dec_expr(rd, func, hdr[2])) == NULL)
+			return fl_func_delete(func), NULL;
+
+		fl_expr_set(&func->ret[i], expr);
+	}
+
+	for(i = 0; i < func->st; i++) {
+		if((expr = dec_expr(rd, func, hdr[2])) == NULL)
+			return fl_func_delete(func), NULL;
+
+		fl_expr_set(&func->next[i], expr);
+	}
+
+	inst = fl_inst_new(func);
+	fl_inst_score(inst, max, hdr[0]);
+
+	return inst;
+}
+
+/**
+ * Decode the evicted hash filters of a checkpoint, replacing the filters
+ * of every group.
+ *   @rd: The reader.
+ *   @ckpt: The checkpoint.
+ *   &returns: True on success, false if invalid.
+ */
+static bool dec_seen(struct rd_t *rd, struct fl_ckpt_t *ckpt)
+{
+	unsigned int i, j, *nseen;
+	uint32_t n, ngroups;
+	uint64_t nevict, hdr[3];
+	struct bloom_t **seen;
+
+	if(!rd_get(rd, &nevict, sizeof(uint64_t)) || !rd_get(rd, &ngroups, sizeof(uint32_t)) || (ngroups != ckpt_groups(ckpt)))
+		return false;
+
+	*ckpt_nevict(ckpt) = nevict;
+
+	for(i = 0; i < ngroups; i++) {
+		if(!rd_get(rd, &n, sizeof(uint32_t)))
+			return false;
+
+		seen = ckpt_seen(ckpt, i, &nseen);
+		for(j = 0; j < *nseen; j++)
+			bloom_destroy(&(*seen)[j]);
+
+		*seen = realloc(*seen, n * sizeof(struct bloom_t));
+		*nseen = 0;
+
+		for(j = 0; j < n; j++) {
+			if(!rd_get(rd, hdr, sizeof(hdr)) || (hdr[0] < 64) || (hdr[0] & (hdr[0] - 1)) || (hdr[1] == 0) || (hdr[1] > 64) || ((size_t)(rd->end - rd->ptr) < (hdr[0] / 8)))
+				return false;
+
+			(*seen)[j] = bloom_init(hdr[0] * 2 / (3 * hdr[1]), hdr[1]);
+			if(((*seen)[j].mask + 1) != hdr[0])
+				return bloom_destroy(&(*seen)[j]), false;
+
+			rd_get(rd, (*seen)[j].bits, hdr[0] / 8);
+			(*seen)[j].count = hdr[2];
+			(*nseen)++;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decode an expression.
+ *   @rd: The reader.
+ *   @func: The function, used to check references.
+ *   @tmp: The number of temporaries.
+ *   &returns: The expression, or null if invalid.
+ */
+static struct fl_expr_t *dec_expr(struct rd_t *rd, const struct fl_func_t *func, unsigned int tmp)
+{
+	uint8_t type;
+	uint32_t id;
+	double flt;
+	struct fl_expr_t *left, *right;
+
+	if(!rd_get(rd, &type, sizeof(uint8_t)))
+		return NULL;
+
+	switch(type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		if(!rd_get(rd, &id, sizeof(uint32_t)))
+			return NULL;
+
+		if(type == fl_in_v)
+			return (id < func->in) ? fl_expr_in(id) : NULL;
+		else if(type == fl_var_v)
+			return (id < tmp) ? fl_expr_var(id) : NULL;
+		else
+			return (id < func->st) ? fl_expr_st(id) : NULL;
+
+	case fl_flt_v:
+		return rd_get(rd, &flt, sizeof(double)) ? fl_expr_flt(flt) : NULL;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		if((left = dec_expr(rd, func, tmp)) == NULL)
+			return NULL;
+
+		if((right = dec_expr(rd, func, tmp)) == NULL)
+			return fl_expr_delete(left), NULL;
+
+		switch(type) {
+		case fl_add_v: return fl_expr_add(left, right);
+		case fl_sub_v: return fl_expr_sub(left, right);
+		case fl_mul_v: return fl_expr_mul(left, right);
+		default: return fl_expr_div(left, right);
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Read bytes from a reader.
+ *   @rd: The reader.
+ *   @ptr: Out. The bytes.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if read, false if past the end.
+ */
+static bool rd_get(struct rd_t *rd, void *ptr, size_t nbytes)
+{
+	if((size_t)(rd->end - rd->ptr) < nbytes)
+		return false;
+
+	memcpy(ptr, rd->ptr, nbytes);
+	rd->ptr += nbytes;
+
+	return true;
+}
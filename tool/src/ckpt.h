@@ -0,0 +1,99 @@
+#ifndef CKPT_H
+#define CKPT_H
+
+/*
+ * checkpoint definitions
+ */
+#define FL_CKPT_MAGIC 0x464c434bu
+#define FL_CKPT_CHUNK (1u << 20)
+
+/**
+ * Checkpoint record tag enumerator.
+ *   @fl_ckpt_val_v: Constants.
+ *   @fl_ckpt_func_v: Functions.
+ *   @fl_ckpt_rand_v: Random number generator state.
+ *   @fl_ckpt_reset_v: Population reset, followed by the full population.
+ *   @fl_ckpt_seen_v: Evicted hash filters.
+ *   @fl_ckpt_trial_v: Trial count.
+ */
+enum fl_ckpt_e {
+	fl_ckpt_val_v = 1,
+	fl_ckpt_func_v = 2,
+	fl_ckpt_rand_v = 3,
+	fl_ckpt_reset_v = 4,
+	fl_ckpt_seen_v = 5,
+	fl_ckpt_trial_v = 6
+};
+
+/**
+ * Growable byte buffer.
+ *   @arr: The array.
+ *   @len, cap: The length and capacity.
+ */
+struct fl_buf_t {
+	uint8_t *arr;
+	size_t len, cap;
+};
+
+/*
+ * buffer declarations
+ */
+void fl_buf_put(struct fl_buf_t *buf, const void *ptr, size_t nbytes);
+
+
+/**
+ * Checkpoint record header, as stored on disk.
+ *   @tag: The tag.
+ *   @len: The payload length in bytes.
+ *   @check: The check over the header and payload.
+ */
+struct fl_chdr_t {
+	uint32_t tag, len;
+	uint64_t check;
+};
+
+/**
+ * Checkpoint structure. Exactly one of the generator and search is set.
+ *   @fd: The file descriptor.
+ *   @path: The path, used to replace the file with a snapshot.
+ *   @gen: The generator.
+ *   @rand: Optional. The random number generator of the generator.
+ *   @ntrials: Optional. The trial count of the generator.
+ *   @search: The search.
+ *   @nvals: The number of constants written.
+ *   @seq: The sequence number of the first instance not written.
+ *   @nevict: The number of evictions when last written.
+ *   @period, last: The save period and last save time in microseconds.
+ */
+struct fl_ckpt_t {
+	int fd;
+	char *path;
+
+	struct fl_gen_t *gen;
+	struct m_rand_t *rand;
+	uint64_t *ntrials;
+
+	struct fl_search_t *search;
+
+	unsigned int nvals;
+	uint64_t seq, nevict;
+	int64_t period, last;
+};
+
+/*
+ * checkpoint declarations
+ */
+char *fl_ckpt_open(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_gen_t *gen, struct m_rand_t *rand, uint64_t *ntrials);
+char *fl_ckpt_open_search(struct fl_ckpt_t **ckpt, const char *path, int64_t period, struct fl_search_t *search);
+void fl_ckpt_close(struct fl_ckpt_t *ckpt);
+
+char *fl_ckpt_save(struct fl_ckpt_t *ckpt);
+char *fl_ckpt_poll(struct fl_ckpt_t *ckpt);
+
+void fl_ckpt_rec(struct fl_buf_t *out, enum fl_ckpt_e tag, const struct fl_buf_t *data);
+uint64_t fl_ckpt_check(uint32_t tag, uint32_t len, const void *data);
+
+void fl_ckpt_enc(struct fl_buf_t *buf, const struct fl_inst_t *inst);
+struct fl_inst_t *fl_ckpt_dec(const uint8_t **ptr, const uint8_t *end);
+
+#endif
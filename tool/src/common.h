@@ -9,6 +9,9 @@
 #include <real.h>
 #include <gmp.h>
 #include <sndfile.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "inc.h"
 
 #endif
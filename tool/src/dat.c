@@ -20,39 +20,28 @@ void dat_cir1(void)
 	r_sys_print(sys, io_file_wrap(stdout));
 
 	{
-		struct rmat_expr_t *mat, *inv;
+		struct rmat_sparse_t *mat;
 		struct rvec_expr_t *vec, *res;
 
-		vec = rvec_expr_new(var->len);
-		mat = rmat_expr_new(var->len, var->len);
-
 		struct r_sys_t *iter;
-		unsigned int i, j;
+		unsigned int i;
 
-		for(iter = sys, j = 0; iter != NULL; iter = iter->next, j++) {
+		for(iter = sys; iter != NULL; iter = iter->next)
 			assert(r_expr_is_zero(iter->rel->right));
 
-			for(i = 0; i < var->len; i++)
-				r_expr_set(rmat_expr_get(mat, j, i), r_fold_expr_clr(r_deriv_expr(iter->rel->left, var->arr[i])));
-
-			r_expr_set(&vec->arr[j], r_fold_expr_clr(r_expr_neg(r_const_expr(iter->rel->left))));
-		}
+		chkabort(rmat_sparse_sys(&mat, &vec, sys, var));
 
 		rvec_expr_dump(vec);
-		rmat_expr_dump(mat);
-
-		inv = rmat_fold_expr_clr(rmat_expr_inv(mat));
+		rmat_sparse_dump(mat);
 
 		rvec_var_dump(var);
-		rmat_expr_dump(inv);
-		res = rvec_fold_expr_clr(rvec_expr_mul(inv, vec));
+		res = rmat_sparse_solve(mat, vec, NULL, 0);
 
 		for(i = 0; i < res->len; i++)
 			printf("%s = %C\n", var->arr[i]->id, r_expr_chunk(res->arr[i]));
 
 		rvec_expr_delete(vec);
-		rmat_expr_delete(mat);
-		rmat_expr_delete(inv);
+		rmat_sparse_delete(mat);
 		rvec_expr_delete(res);
 	}
 
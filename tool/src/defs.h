@@ -4,8 +4,19 @@
 /*
  * structure prototypes
  */
+struct fl_arena_t;
+struct fl_batch_t;
+struct fl_cache_t;
+struct fl_ckpt_t;
+struct fl_fit_t;
 struct fl_func_t;
 struct fl_gen_t;
 struct fl_inst_t;
+struct fl_island_t;
+struct fl_jit_t;
+struct fl_prog_t;
+struct fl_screen_t;
+struct fl_search_t;
+struct fl_stream_t;
 
 #endif
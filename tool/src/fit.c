@@ -0,0 +1,472 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static double fit_pass(const struct fl_fit_t *fit, struct fl_func_t *func, const double *val, unsigned int n, double *jtj, double *jtr);
+static bool fit_solve(const double *jtj, const double *jtr, double *delta, unsigned int n);
+
+static unsigned int fit_count(const struct fl_expr_t *expr);
+static void fit_load(const struct fl_expr_t *expr, double *val, unsigned int *k);
+static bool fit_store(struct fl_expr_t *expr, const double *val, unsigned int *k);
+static double fit_eval(const struct fl_expr_t *expr, double in, const double *var, const double *dvar, const double *st, const double *dst, const double *val, unsigned int n, unsigned int *k, double *grad);
+
+
+/**
+ * Create a constant fitter. The signals are referenced, not copied.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The number of samples to fit against.
+ *   @niters: The maximum number of Gauss-Newton iterations.
+ *   &returns: The fitter.
+ */
+struct fl_fit_t *fl_fit_new(const double *in, const double *ref, unsigned int len, unsigned int niters)
+{
+	struct fl_fit_t *fit;
+
+	fit = malloc(sizeof(struct fl_fit_t));
+	fit->in = in;
+	fit->ref = ref;
+	fit->len = len;
+	fit->niters = niters;
+
+	return fit;
+}
+
+/**
+ * Delete a constant fitter.
+ *   @fit: The fitter.
+ */
+void fl_fit_delete(struct fl_fit_t *fit)
+{
+	free(fit);
+}
+
+
+/**
+ * Fit the constants of a function to the reference signal by least
+ * squares. The derivatives of the output with respect to every constant
+ * are carried forward through the temporaries and the state, and each
+ * iteration solves the normal equations for a Gauss-Newton step. Functions
+ * that are linear in their constants converge in a single step, the
+ * second pass only confirming it. Steps that do not reduce the error are
+ * halved, and the constants are only replaced if the error decreases.
+ *   @fit: The fitter.
+ *   @func: The function.
+ *   &returns: True if the constants were changed.
+ */
+bool fl_fit_run(const struct fl_fit_t *fit, struct fl_func_t *func)
+{
+	double sse, best;
+	unsigned int i, k, n, iter, half;
+	double val[FL_FITMAX], cur[FL_FITMAX], delta[FL_FITMAX];
+	double jtj[FL_FITMAX * FL_FITMAX], jtr[FL_FITMAX], tjtj[FL_FITMAX * FL_FITMAX], tjtr[FL_FITMAX];
+
+	if((func->in != 1) || (func->out != 1))
+		return false;
+
+	n = 0;
+	for(i = 0; i < func->tmp; i++)
+		n += fit_count(func->let[i]);
+
+	n += fit_count(func->ret[0]);
+
+	for(i = 0; i < func->st; i++)
+		n += fit_count(func->next[i]);
+
+	if((n == 0) || (n > FL_FITMAX))
+		return false;
+
+	k = 0;
+	for(i = 0; i < func->tmp; i++)
+		fit_load(func->let[i], val, &k);
+
+	fit_load(func->ret[0], val, &k);
+
+	for(i = 0; i < func->st; i++)
+		fit_load(func->next[i], val, &k);
+
+	best = fit_pass(fit, func, val, n, jtj, jtr);
+	if(!isfinite(best))
+		return false;
+
+	memcpy(cur, val, n * sizeof(double));
+
+	for(iter = 0; iter < fit->niters; iter++) {
+		if(!fit_solve(jtj, jtr, delta, n))
+			break;
+
+		for(i = 0; i < n; i++) {
+			if(fabs(delta[i]) > 1e-12 * (1.0 + fabs(cur[i])))
+				break;
+		}
+
+		if(i == n)
+			break;
+
+		for(half = 0; half < 4; half++) {
+			double next[n];
+
+			for(i = 0; i < n; i++)
+				next[i] = cur[i] + delta[i];
+
+			sse = fit_pass(fit, func, next, n, tjtj, tjtr);
+			if(sse < best) {
+				best = sse;
+				memcpy(cur, next, n * sizeof(double));
+				memcpy(jtj, tjtj, n * n * sizeof(double));
+				memcpy(jtr, tjtr, n * sizeof(double));
+				break;
+			}
+
+			for(i = 0; i < n; i++)
+				delta[i] /= 2.0;
+		}
+
+		if(half == 4)
+			break;
+	}
+
+	if(memcmp(cur, val, n * sizeof(double)) == 0)
+		return false;
+
+	k = 0;
+	for(i = 0; i < func->tmp; i++)
+		fit_store(func->let[i], cur, &k);
+
+	fit_store(func->ret[0], cur, &k);
+
+	for(i = 0; i < func->st; i++)
+		fit_store(func->next[i], cur, &k);
+
+	return true;
+}
+
+/**
+ * Compute the hash of a fitter configuration, covering the fitted samples
+ * and the iteration limit.
+ *   @fit: The fitter.
+ *   &returns: The hash.
+ */
+uint64_t fl_fit_hash(const struct fl_fit_t *fit)
+{
+	uint64_t hash = 0;
+
+	hash = mash64(hash, fit->len);
+	hash = mash64(hash, fit->niters);
+	mash64buf(&hash, (void *)fit->in, fit->len * sizeof(double));
+	mash64buf(&hash, (void *)fit->ref, fit->len * sizeof(double));
+
+	return hash;
+}
+
+
+/**
+ * Evaluate a function over the fitted samples with the given constants,
+ * accumulating the normal equations.
+ *   @fit: The fitter.
+ *   @func: The function.
+ *   @val: The constant values.
+ *   @n: The number of constants.
+ *   @jtj: Out. The Gauss-Newton matrix, row-major.
+ *   @jtr: Out. The gradient of the residuals.
+ *   &returns: The sum of squared residuals, infinite if not finite.
+ */
+static double fit_pass(const struct fl_fit_t *fit, struct fl_func_t *func, const double *val, unsigned int n, double *jtj, double *jtr)
+{
+	double y, r, sse = 0.0;
+	unsigned int i, j, a, b, k;
+	double var[func->tmp + 1], dvar[func->tmp * n + 1];
+	double st[func->st + 1], dst[func->st * n + 1];
+	double grad[n], tmp[n];
+
+	for(i = 0; i < func->st; i++)
+		st[i] = 0.0;
+
+	for(i = 0; i < func->st * n; i++)
+		dst[i] = 0.0;
+
+	for(a = 0; a < n * n; a++)
+		jtj[a] = 0.0;
+
+	for(a = 0; a < n; a++)
+		jtr[a] = 0.0;
+
+	for(i = 0; i < fit->len; i++) {
+		k = 0;
+
+		for(j = 0; j < func->tmp; j++)
+			var[j] = fit_eval(func->let[j], fit->in[i], var, dvar, st, dst, val, n, &k, &dvar[j * n]);
+
+		y = fit_eval(func->ret[0], fit->in[i], var, dvar, st, dst, val, n, &k, grad);
+
+		for(j = 0; j < func->st; j++) {
+			st[j] = fit_eval(func->next[j], fit->in[i], var, dvar, st, dst, val, n, &k, tmp);
+			memcpy(&dst[j * n], tmp, n * sizeof(double));
+		}
+
+		r = fit->ref[i] - y;
+		if(!isfinite(r))
+			return INFINITY;
+
+		sse += r * r;
+
+		for(a = 0; a < n; a++) {
+			if(!isfinite(grad[a]))
+				return INFINITY;
+
+			jtr[a] += grad[a] * r;
+			for(b = a; b < n; b++)
+				jtj[a * n + b] += grad[a] * grad[b];
+		}
+	}
+
+	for(a = 0; a < n; a++) {
+		for(b = 0; b < a; b++)
+			jtj[a * n + b] = jtj[b * n + a];
+	}
+
+	return sse;
+}
+
+/**
+ * Solve the normal equations for a Gauss-Newton step using Gaussian
+ * elimination with partial pivoting. The diagonal is slightly damped, and
+ * constants that have no effect on the output are left unchanged.
+ *   @jtj: The Gauss-Newton matrix.
+ *   @jtr: The gradient of the residuals.
+ *   @delta: Out. The step.
+ *   @n: The number of constants.
+ *   &returns: True on success, false if singular.
+ */
+static bool fit_solve(const double *jtj, const double *jtr, double *delta, unsigned int n)
+{
+	double f, t;
+	unsigned int i, j, k, p;
+	double a[n][n + 1];
+
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++)
+			a[i][j] = jtj[i * n + j];
+
+		a[i][n] = jtr[i];
+		a[i][i] = (a[i][i] == 0.0) ? 1.0 : (a[i][i] * (1.0 + 1e-9));
+	}
+
+	for(k = 0; k < n; k++) {
+		p = k;
+		for(i = k + 1; i < n; i++) {
+			if(fabs(a[i][k]) > fabs(a[p][k]))
+				p = i;
+		}
+
+		if(a[p][k] == 0.0)
+			return false;
+
+		for(j = k; j <= n; j++) {
+			t = a[k][j];
+			a[k][j] = a[p][j];
+			a[p][j] = t;
+		}
+
+		for(i = k + 1; i < n; i++) {
+			f = a[i][k] / a[k][k];
+			for(j = k; j <= n; j++)
+				a[i][j] -= f * a[k][j];
+		}
+	}
+
+	for(i = n; i-- > 0; ) {
+		t = a[i][n];
+		for(j = i + 1; j < n; j++)
+			t -= a[i][j] * delta[j];
+
+		delta[i] = t / a[i][i];
+		if(!isfinite(delta[i]))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Count the constants of an expression.
+ *   @expr: The expression.
+ *   &returns: The number of constants.
+ */
+static unsigned int fit_count(const struct fl_expr_t *expr)
+{
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		return 0;
+
+	case fl_flt_v:
+		return 1;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		return fit_count(expr->data.op2.left) + fit_count(expr->data.op2.right);
+	}
+
+	__builtin_unreachable();
+}
+
+/**
+ * Load the constants of an expression in evaluation order.
+ *   @expr: The expression.
+ *   @val: The value array.
+ *   @k: Ref. The constant index.
+ */
+static void fit_load(const struct fl_expr_t *expr, double *val, unsigned int *k)
+{
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		break;
+
+	case fl_flt_v:
+		val[(*k)++] = expr->data.flt;
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		fit_load(expr->data.op2.left, val, k);
+		fit_load(expr->data.op2.right, val, k);
+		break;
+	}
+}
+
+/**
+ * Store the constants of an expression in evaluation order. The paths to
+ * the changed constants are marked stale and no longer canonical.
+ *   @expr: The expression.
+ *   @val: The value array.
+ *   @k: Ref. The constant index.
+ *   &returns: True if changed.
+ */
+static bool fit_store(struct fl_expr_t *expr, const double *val, unsigned int *k)
+{
+	bool left, right;
+
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		return false;
+
+	case fl_flt_v:
+		if(memcmp(&expr->data.flt, &val[*k], sizeof(double)) == 0) {
+			(*k)++;
+			return false;
+		}
+
+		expr->data.flt = val[(*k)++];
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		left = fit_store(expr->data.op2.left, val, k);
+		right = fit_store(expr->data.op2.right, val, k);
+		if(!left && !right)
+			return false;
+
+		break;
+	}
+
+	expr->dirty = true;
+	expr->canon = false;
+
+	return true;
+}
+
+/**
+ * Evaluate an expression and its gradient with respect to the constants.
+ *   @expr: The expression.
+ *   @in: The input value.
+ *   @var, dvar: The temporary values and gradients.
+ *   @st, dst: The state values and gradients.
+ *   @val: The constant values.
+ *   @n: The number of constants.
+ *   @k: Ref. The constant index.
+ *   @grad: Out. The gradient.
+ *   &returns: The value.
+ */
+static double fit_eval(const struct fl_expr_t *expr, double in, const double *var, const double *dvar, const double *st, const double *dst, const double *val, unsigned int n, unsigned int *k, double *grad)
+{
+	double l, r, dl[n];
+	unsigned int i;
+
+	switch(expr->type) {
+	case fl_in_v:
+		for(i = 0; i < n; i++)
+			grad[i] = 0.0;
+
+		return in;
+
+	case fl_var_v:
+		memcpy(grad, &dvar[expr->data.id * n], n * sizeof(double));
+		return var[expr->data.id];
+
+	case fl_st_v:
+		memcpy(grad, &dst[expr->data.id * n], n * sizeof(double));
+		return st[expr->data.id];
+
+	case fl_flt_v:
+		for(i = 0; i < n; i++)
+			grad[i] = 0.0;
+
+		grad[*k] = 1.0;
+		return val[(*k)++];
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		break;
+	}
+
+	l = fit_eval(expr->data.op2.left, in, var, dvar, st, dst, val, n, k, dl);
+	r = fit_eval(expr->data.op2.right, in, var, dvar, st, dst, val, n, k, grad);
+
+	switch(expr->type) {
+	case fl_add_v:
+		for(i = 0; i < n; i++)
+			grad[i] = dl[i] + grad[i];
+
+		return l + r;
+
+	case fl_sub_v:
+		for(i = 0; i < n; i++)
+			grad[i] = dl[i] - grad[i];
+
+		return l - r;
+
+	case fl_mul_v:
+		for(i = 0; i < n; i++)
+			grad[i] = dl[i] * r + l * grad[i];
+
+		return l * r;
+
+	case fl_div_v:
+		for(i = 0; i < n; i++)
+			grad[i] = (dl[i] - (l / r) * grad[i]) / r;
+
+		return l / r;
+
+	default:
+		break;
+	}
+
+	__builtin_unreachable();
+}
@@ -0,0 +1,30 @@
+#ifndef FIT_H
+#define FIT_H
+
+/*
+ * fit definitions
+ */
+#define FL_FITMAX 8
+
+/**
+ * Constant fitting structure.
+ *   @in, ref: The input and reference signals.
+ *   @len: The number of fitted samples.
+ *   @niters: The maximum number of Gauss-Newton iterations.
+ */
+struct fl_fit_t {
+	const double *in, *ref;
+	unsigned int len;
+	unsigned int niters;
+};
+
+/*
+ * fit declarations
+ */
+struct fl_fit_t *fl_fit_new(const double *in, const double *ref, unsigned int len, unsigned int niters);
+void fl_fit_delete(struct fl_fit_t *fit);
+
+bool fl_fit_run(const struct fl_fit_t *fit, struct fl_func_t *func);
+uint64_t fl_fit_hash(const struct fl_fit_t *fit);
+
+#endif
@@ -1,6 +1,14 @@
 #include "common.h"
 
 
+/*
+ * local declarations
+ */
+static void gen_compact(struct fl_gen_t *gen, unsigned int cap);
+static bool gen_seen(const struct fl_gen_t *gen, uint64_t hash);
+static void gen_evict(struct fl_gen_t *gen, struct fl_inst_t *inst);
+static int gen_order(const void *left, const void *right);
+
 
 /**
  * Normalize weights.
@@ -25,13 +33,17 @@ struct fl_gen_t *fl_gen_new(void)
 	struct fl_gen_t *gen;
 
 	gen = malloc(sizeof(struct fl_gen_t));
-	gen->tree = avltree_init((compare_f)fl_inst_cmp, delete_noop);
+	gen->set = hashset_init((compare_f)fl_inst_cmp, delete_noop);
+	gen->seen = malloc(0);
+	gen->nseen = 0;
 	gen->val = malloc(2 * sizeof(double));
 	gen->val[0] = 0.0;
 	gen->val[1] = 1.0;
 	gen->nvals = 2;
 	gen->arr = malloc(0);
-	gen->len = 0;
+	gen->len = gen->cap = 0;
+	gen->seq = gen->nevict = 0;
+	gen->arena = fl_arena_new();
 
 	return gen;
 }
@@ -47,7 +59,12 @@ void fl_gen_delete(struct fl_gen_t *gen)
 	for(i = 0; i < gen->len; i++)
 		fl_inst_delete(gen->arr[i]);
 
-	avltree_destroy(&gen->tree);
+	for(i = 0; i < gen->nseen; i++)
+		bloom_destroy(&gen->seen[i]);
+
+	hashset_destroy(&gen->set);
+	fl_arena_delete(gen->arena);
+	free(gen->seen);
 	free(gen->val);
 	free(gen->arr);
 	free(gen);
@@ -55,14 +72,15 @@ void fl_gen_delete(struct fl_gen_t *gen)
 
 
 /**
- * Check if the generator already contains the given instance.
+ * Check if the generator already contains the given instance, or has
+ * evicted an instance with the same hash.
  *   @gen: The generator.
  *   @inst: The instance.
  *   &returns: True if already found.
  */
 bool fl_gen_find(struct fl_gen_t *gen, struct fl_inst_t *inst)
 {
-	return avltree_lookup(&gen->tree, inst) != NULL;
+	return (hashset_lookup(&gen->set, inst->hash, inst) != NULL) || gen_seen(gen, inst->hash);
 	unsigned int i;
 
 	for(i = 0; i < gen->len; i++) {
@@ -74,15 +92,21 @@ bool fl_gen_find(struct fl_gen_t *gen, struct fl_inst_t *inst)
 }
 
 /**
- * Add an instance to the generator.
+ * Add an instance to the generator. When the population is capped and has
+ * grown past the slack, the worst ranked instances are evicted first, so
+ * every earlier instance should already be scored.
  *   @gen: The generator.
  *   @inst: The instance.
  */
 void fl_gen_add(struct fl_gen_t *gen, struct fl_inst_t *inst)
 {
+	if((gen->cap > 0) && (gen->len >= (gen->cap + gen->cap / FL_GEN_SLACK)))
+		gen_compact(gen, gen->cap);
+
+	inst->seq = gen->seq++;
 	gen->arr = realloc(gen->arr, (gen->len + 1) * sizeof(void *));
 	gen->arr[gen->len++] = inst;
-	avltree_insert(&gen->tree, inst, inst);
+	hashset_insert(&gen->set, inst->hash, inst);
 }
 
 /**
@@ -103,12 +127,66 @@ void fl_gen_const(struct fl_gen_t *gen, double val)
 	gen->val[gen->nvals++] = val;
 }
 
+/**
+ * Cap the population of the generator, evicting immediately if needed.
+ * Evicted instances are only remembered by hash, so they are still
+ * rejected as duplicates, with a small chance of rejecting a new instance.
+ *   @gen: The generator.
+ *   @cap: The cap, or zero for unbounded.
+ */
+void fl_gen_cap(struct fl_gen_t *gen, unsigned int cap)
+{
+	gen->cap = cap;
+
+	if((cap > 0) && (gen->len > cap))
+		gen_compact(gen, cap);
+}
+
+/**
+ * Remove every instance from the generator without remembering them.
+ *   @gen: The generator.
+ */
+void fl_gen_clear(struct fl_gen_t *gen)
+{
+	unsigned int i;
+
+	for(i = 0; i < gen->len; i++) {
+		hashset_remove(&gen->set, gen->arr[i]->hash, gen->arr[i]);
+		fl_inst_delete(gen->arr[i]);
+	}
+
+	gen->len = 0;
+}
+
+/**
+ * Retrieve the best ranked instances of the generator.
+ *   @gen: The generator.
+ *   @inst: Out. The instance array, best first.
+ *   @n: The maximum number of instances.
+ *   &returns: The number of instances.
+ */
+unsigned int fl_gen_best(const struct fl_gen_t *gen, struct fl_inst_t **inst, unsigned int n)
+{
+	struct fl_inst_t **sort;
+
+	if(n > gen->len)
+		n = gen->len;
+
+	sort = malloc(gen->len * sizeof(void *));
+	memcpy(sort, gen->arr, gen->len * sizeof(void *));
+	qsort(sort, gen->len, sizeof(void *), gen_order);
+	memcpy(inst, sort, n * sizeof(void *));
+	free(sort);
+
+	return n;
+}
+
 
 struct fl_expr_t *fl_gen_expr(struct fl_func_t *func, unsigned int tmp, struct m_rand_t *rand)
 {
 	unsigned int v;
 
-	v = m_rand_u32(rand) % (tmp + func->in + func->st);
+	v = m_rand_bound(rand, tmp + func->in + func->st);
 	if(v < tmp)
 		return fl_expr_var(v);
 	else
@@ -128,28 +206,32 @@ struct fl_expr_t *fl_gen_expr(struct fl_func_t *func, unsigned int tmp, struct m
 }
 
 /**
- * Trial a random modification.
- *   @gen: The generator.
+ * Create a random modification of a function.
+ *   @parent: The parent function.
+ *   @val: The constant value array.
+ *   @nvals: The number of constants.
  *   @weight: The weights to apply.
  *   @rand: Optional. The random number generator.
- *   &returns: The instance if unique, null on duplicate.
+ *   &returns: The modified copy of the function.
  */
-struct fl_inst_t *fl_gen_trial(struct fl_gen_t *gen, const struct fl_weight_t *weight, struct m_rand_t *rand)
+struct fl_func_t *fl_gen_mutate(const struct fl_func_t *parent, const double *val, unsigned int nvals, const struct fl_weight_t *weight, struct m_rand_t *rand)
 {
 	unsigned int tmp;
-	struct fl_inst_t *inst;
 	struct fl_func_t *func;
 	struct fl_expr_t **expr;
 
-	func = fl_func_copy(gen->arr[m_rand_u32(rand) % gen->len]->func);
+	func = fl_func_copy(parent);
 	if(m_rand_d(rand) < 0.1) {
-		fl_func_tmp(func, fl_expr_flt(0.0));
+		tmp = m_rand_bound(rand, func->out + func->st);
+		expr = (tmp < func->out) ? &func->ret[tmp] : &func->next[tmp - func->out];
+		fl_func_tmp(func, *expr);
+		*expr = fl_expr_var(func->tmp - 1);
 	}
 	else {
 		expr = fl_func_rand(func, &tmp, rand);
 
 		if(m_rand_d(rand) < 0.2) {
-			fl_expr_set(expr, fl_expr_flt(gen->val[m_rand_u32(rand) % gen->nvals]));
+			fl_expr_set(expr, fl_expr_flt(val[m_rand_bound(rand, nvals)]));
 		}
 		else if(m_rand_d(rand) < 0.5) {
 			fl_expr_set(expr, fl_gen_expr(func, tmp, rand));
@@ -171,21 +253,62 @@ struct fl_inst_t *fl_gen_trial(struct fl_gen_t *gen, const struct fl_weight_t *w
 		}
 	}
 
+	return func;
+}
+
+/**
+ * Trial a random modification. When the population is capped, the parent
+ * is the better of two random instances and a unique trial is copied out
+ * of the arena, so evicting it releases its memory.
+ *   @gen: The generator.
+ *   @weight: The weights to apply.
+ *   @rand: Optional. The random number generator.
+ *   &returns: The instance if unique, null on duplicate.
+ */
+struct fl_inst_t *fl_gen_trial(struct fl_gen_t *gen, const struct fl_weight_t *weight, struct m_rand_t *rand)
+{
+	struct fl_mark_t mark;
+	struct fl_arena_t *prev;
+	struct fl_inst_t *inst, *parent, *other;
+	struct fl_func_t *func;
+
+	parent = gen->arr[m_rand_bound(rand, gen->len)];
+	if(gen->cap > 0) {
+		other = gen->arr[m_rand_bound(rand, gen->len)];
+		if(fl_inst_rank(other, parent) < 0)
+			parent = other;
+	}
+
+	mark = fl_arena_mark(gen->arena);
+	prev = fl_arena_bind(gen->arena);
+	func = fl_gen_mutate(parent->func, gen->val, gen->nvals, weight, rand);
+	fl_arena_bind(prev);
+
 	inst = fl_inst_new(func);
 
 	if(fl_gen_find(gen, inst)) {
 		fl_inst_delete(inst);
+		fl_arena_reset(gen->arena, mark);
 		return NULL;
 	}
-	else {
-		fl_gen_add(gen, inst);
-		return inst;
+
+	if(gen->cap > 0) {
+		prev = fl_arena_bind(NULL);
+		inst->func = fl_func_copy(func);
+		fl_func_delete(func);
+		fl_arena_bind(prev);
+		fl_arena_reset(gen->arena, mark);
 	}
+
+	fl_gen_add(gen, inst);
+
+	return inst;
 }
 
 
 /**
- * Create an instance.
+ * Create an instance. The function is canonicalized first, so equivalent
+ * functions produce equal instances.
  *   @func: Consumed. The function.
  *   &returns: The instance.
  */
@@ -193,10 +316,15 @@ struct fl_inst_t *fl_inst_new(struct fl_func_t *func)
 {
 	struct fl_inst_t *inst;
 
+	fl_func_canon(func);
+
 	inst = malloc(sizeof(struct fl_inst_t));
 	inst->hash = fl_func_hash(func);
 	inst->size = fl_func_size(func);
 	inst->nterms = fl_func_nterms(func);
+	inst->seq = 0;
+	inst->max = INFINITY;
+	inst->idx = 0;
 	inst->func = func;
 
 	return inst;
@@ -213,6 +341,19 @@ void fl_inst_delete(struct fl_inst_t *inst)
 }
 
 
+/**
+ * Score an instance.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of accepted samples.
+ */
+void fl_inst_score(struct fl_inst_t *inst, double max, unsigned int idx)
+{
+	inst->max = max;
+	inst->idx = idx;
+}
+
+
 /**
  * Efficiently compare two instances.
  *   @left: The left instance.
@@ -236,3 +377,115 @@ int fl_inst_cmp(struct fl_inst_t *left, struct fl_inst_t *right)
 	else
 		return fl_func_cmp(left->func, right->func);
 }
+
+/**
+ * Rank two instances by score. Instances accepting more samples rank
+ * first, then those with less error, then smaller ones.
+ *   @left: The left instance.
+ *   @right: The right instance.
+ *   &returns: Negative if the left ranks first, positive if the right
+ *     ranks first, zero if tied.
+ */
+int fl_inst_rank(const struct fl_inst_t *left, const struct fl_inst_t *right)
+{
+	if(left->idx != right->idx)
+		return (left->idx > right->idx) ? -1 : 1;
+	else if(left->max != right->max)
+		return (left->max < right->max) ? -1 : 1;
+	else if(left->size != right->size)
+		return (left->size < right->size) ? -1 : 1;
+	else
+		return 0;
+}
+
+
+/**
+ * Evict all but the best ranked instances of a generator, keeping the
+ * survivors in their original order.
+ *   @gen: The generator.
+ *   @cap: The number of instances to keep.
+ */
+static void gen_compact(struct fl_gen_t *gen, unsigned int cap)
+{
+	unsigned int i, n;
+	struct fl_inst_t **sort, *cut;
+
+	sort = malloc(gen->len * sizeof(void *));
+	memcpy(sort, gen->arr, gen->len * sizeof(void *));
+	qsort(sort, gen->len, sizeof(void *), gen_order);
+	cut = sort[cap - 1];
+	free(sort);
+
+	for(i = n = 0; i < gen->len; i++) {
+		if(gen_order(&gen->arr[i], &cut) <= 0)
+			gen->arr[n++] = gen->arr[i];
+		else
+			gen_evict(gen, gen->arr[i]);
+	}
+
+	gen->len = n;
+}
+
+/**
+ * Check if a hash was evicted from a generator.
+ *   @gen: The generator.
+ *   @hash: The hash.
+ *   &returns: True if possibly evicted.
+ */
+static bool gen_seen(const struct fl_gen_t *gen, uint64_t hash)
+{
+	unsigned int i;
+
+	for(i = 0; i < gen->nseen; i++) {
+		if(bloom_query(&gen->seen[i], hash))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Evict an instance from a generator, remembering its hash. A new filter
+ * twice the size is started whenever the last one reaches its expected
+ * number of insertions.
+ *   @gen: The generator.
+ *   @inst: The instance.
+ */
+static void gen_evict(struct fl_gen_t *gen, struct fl_inst_t *inst)
+{
+	struct bloom_t *last;
+	size_t n;
+
+	last = (gen->nseen > 0) ? &gen->seen[gen->nseen - 1] : NULL;
+	n = (last != NULL) ? 2 * (last->mask + 1) / (3 * last->k) : 0;
+
+	if((last == NULL) || (last->count >= n)) {
+		n = (n > 0) ? 2 * n : 4 * (size_t)gen->cap;
+		gen->seen = realloc(gen->seen, (gen->nseen + 1) * sizeof(struct bloom_t));
+		gen->seen[gen->nseen++] = bloom_init(n, FL_GEN_PROBES);
+		last = &gen->seen[gen->nseen - 1];
+	}
+
+	bloom_insert(last, inst->hash);
+	gen->nevict++;
+	hashset_remove(&gen->set, inst->hash, inst);
+	fl_inst_delete(inst);
+}
+
+/**
+ * Order two instance references by rank, breaking ties by sequence.
+ *   @left: The left reference.
+ *   @right: The right reference.
+ *   &returns: Their order.
+ */
+static int gen_order(const void *left, const void *right)
+{
+	const struct fl_inst_t *a = *(struct fl_inst_t *const *)left, *b = *(struct fl_inst_t *const *)right;
+	int cmp;
+
+	cmp = fl_inst_rank(a, b);
+	if(cmp != 0)
+		return cmp;
+
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq) ? 1 : 0;
+}
@@ -15,22 +15,39 @@ struct fl_weight_t {
 void fl_weight_norm(struct fl_weight_t *weight);
 
 
+/*
+ * generator definitions
+ */
+#define FL_GEN_SLACK  4
+#define FL_GEN_PROBES 10
+
 /**
  * Generator structure.
- *   @tree: Fast lookup tree.
+ *   @set: Fast lookup set.
+ *   @seen: The filters of evicted hashes, each twice the size of the last.
+ *   @nseen: The number of filters.
  *   @val: Constant value array.
  *   @nvals: The number of constants.
  *   @arr: The array.
  *   @len: The length.
+ *   @cap: The population cap, zero if unbounded.
+ *   @seq: The next instance sequence number.
+ *   @nevict: The number of evicted instances.
+ *   @arena: The arena for trial functions.
  */
 struct fl_gen_t {
-	struct avltree_t tree;
+	struct hashset_t set;
+	struct bloom_t *seen;
+	unsigned int nseen;
 
 	double *val;
 	unsigned int nvals;
 
 	struct fl_inst_t **arr;
-	unsigned int len;
+	unsigned int len, cap;
+	uint64_t seq, nevict;
+
+	struct fl_arena_t *arena;
 };
 
 /*
@@ -44,19 +61,27 @@ void fl_gen_delete(struct fl_gen_t *gen);
 bool fl_gen_find(struct fl_gen_t *gen, struct fl_inst_t *inst);
 void fl_gen_add(struct fl_gen_t *gen, struct fl_inst_t *inst);
 void fl_gen_const(struct fl_gen_t *gen, double val);
+void fl_gen_cap(struct fl_gen_t *gen, unsigned int cap);
+void fl_gen_clear(struct fl_gen_t *gen);
+unsigned int fl_gen_best(const struct fl_gen_t *gen, struct fl_inst_t **inst, unsigned int n);
 
+struct fl_func_t *fl_gen_mutate(const struct fl_func_t *parent, const double *val, unsigned int nvals, const struct fl_weight_t *weight, struct m_rand_t *rand);
 struct fl_inst_t *fl_gen_trial(struct fl_gen_t *gen, const struct fl_weight_t *weight, struct m_rand_t *rand);
 
 
 /**
  * Instance structure.
  *   @hash: The hash.
+ *   @seq: The sequence number within the generator.
  *   @size, nterms: The size and number of terminals.
+ *   @max, idx: The score as maximum error and accepted samples.
  *   @func: The function.
  */
 struct fl_inst_t {
-	uint64_t hash;
+	uint64_t hash, seq;
 	unsigned int size, nterms;
+	double max;
+	unsigned int idx;
 	struct fl_func_t *func;
 };
 
@@ -68,6 +93,9 @@ struct fl_inst_t;
 struct fl_inst_t *fl_inst_new(struct fl_func_t *func);
 void fl_inst_delete(struct fl_inst_t *inst);
 
+void fl_inst_score(struct fl_inst_t *inst, double max, unsigned int idx);
+
 int fl_inst_cmp(struct fl_inst_t *left, struct fl_inst_t *right);
+int fl_inst_rank(const struct fl_inst_t *left, const struct fl_inst_t *right);
 
 #endif
@@ -0,0 +1,281 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static char *island_cloexec(int fd, bool en);
+
+
+/**
+ * Spawn a ring of island processes and wait for them to finish. Each
+ * island is started as `path island <idx> <n> <rd> <wr>`, reading
+ * migrants from the previous island and writing to the next. Only the
+ * pipe ends of an island are inherited by it, so a crashed island only
+ * cuts its own links.
+ *   @path: The executable path.
+ *   @n: The number of islands, at least one.
+ *   @status: Out. The exit status of each island, negative if it was
+ *     terminated abnormally or never started.
+ *   &returns: Error.
+ */
+char *fl_island_spawn(const char *path, unsigned int n, int *status)
+{
+	unsigned int i, k;
+	int fd[n][2];
+	char arg[4][16], *err = NULL;
+	sys_pid_t pid[n];
+	bool run[n];
+
+	for(i = 0; i < n; i++) {
+		if(pipe(fd[i]) < 0)
+			err = mprintf("Failed to create island pipe. %s.", strerror(errno));
+		else if(((err = island_cloexec(fd[i][0], true)) != NULL) || ((err = island_cloexec(fd[i][1], true)) != NULL))
+			close(fd[i][0]), close(fd[i][1]);
+
+		if(err != NULL) {
+			for(k = 0; k < i; k++)
+				close(fd[k][0]), close(fd[k][1]);
+
+			return err;
+		}
+	}
+
+	for(i = 0; i < n; i++) {
+		run[i] = false;
+		status[i] = -1;
+
+		if(err != NULL)
+			continue;
+
+		snprintf(arg[0], sizeof(arg[0]), "%u", i);
+		snprintf(arg[1], sizeof(arg[1]), "%u", n);
+		snprintf(arg[2], sizeof(arg[2]), "%d", fd[i][0]);
+		snprintf(arg[3], sizeof(arg[3]), "%d", fd[(i + 1) % n][1]);
+
+		if(((err = island_cloexec(fd[i][0], false)) != NULL) || ((err = island_cloexec(fd[(i + 1) % n][1], false)) != NULL))
+			continue;
+
+		err = sys_spawn(&pid[i], path, (char *[]){ (char *)path, "island", arg[0], arg[1], arg[2], arg[3], NULL });
+		run[i] = (err == NULL);
+
+		if(err == NULL)
+			err = island_cloexec(fd[i][0], true);
+
+		if(err == NULL)
+			err = island_cloexec(fd[(i + 1) % n][1], true);
+	}
+
+	for(i = 0; i < n; i++)
+		close(fd[i][0]), close(fd[i][1]);
+
+	for(i = 0; i < n; i++) {
+		if(run[i])
+			status[i] = sys_wait(pid[i]);
+	}
+
+	return err;
+}
+
+
+/**
+ * Create an island from the arguments passed by the spawner.
+ *   @island: Out. The island.
+ *   @argv: The arguments following `island`.
+ *   &returns: Error.
+ */
+char *fl_island_new(struct fl_island_t **island, char *const *argv)
+{
+	unsigned int i, idx, n;
+	int rd, wr;
+
+	for(i = 0; i < 4; i++) {
+		if(argv[i] == NULL)
+			return mprintf("Island requires an index, count, and two descriptors.");
+	}
+
+	if((sscanf(argv[0], "%u", &idx) != 1) || (sscanf(argv[1], "%u", &n) != 1) || (sscanf(argv[2], "%d", &rd) != 1) || (sscanf(argv[3], "%d", &wr) != 1))
+		return mprintf("Invalid island arguments.");
+
+	if(idx >= n)
+		return mprintf("Island index %u is out of range for %u islands.", idx, n);
+
+	if((fcntl(rd, F_SETFL, O_NONBLOCK) < 0) || (fcntl(wr, F_SETFL, O_NONBLOCK) < 0))
+		return mprintf("Failed to configure island pipes. %s.", strerror(errno));
+
+	signal(SIGPIPE, SIG_IGN);
+
+	*island = malloc(sizeof(struct fl_island_t));
+	(*island)->idx = idx;
+	(*island)->n = n;
+	(*island)->rd = rd;
+	(*island)->wr = wr;
+	(*island)->buf = (struct fl_buf_t){ malloc(0), 0, 0 };
+	(*island)->nsent = (*island)->nrecv = (*island)->ndrop = 0;
+
+	return NULL;
+}
+
+/**
+ * Delete an island.
+ *   @island: The island.
+ */
+void fl_island_delete(struct fl_island_t *island)
+{
+	if(island->rd >= 0)
+		close(island->rd);
+
+	if(island->wr >= 0)
+		close(island->wr);
+
+	free(island->buf.arr);
+	free(island);
+}
+
+
+/**
+ * Send the best instances of a generator to the next island. The
+ * migrants are packed into a single checkpoint record no larger than an
+ * atomic pipe write. If the pipe is full or the next island is gone, the
+ * migrants are dropped rather than blocking.
+ *   @island: The island.
+ *   @gen: The generator.
+ *   @n: The maximum number of migrants.
+ */
+void fl_island_send(struct fl_island_t *island, const struct fl_gen_t *gen, unsigned int n)
+{
+	ssize_t ret;
+	uint32_t i, cnt;
+	struct fl_inst_t *best[n + 1];
+	struct fl_buf_t out = { malloc(0), 0, 0 }, data = { malloc(0), 0, 0 }, inst = { malloc(0), 0, 0 };
+
+	n = fl_gen_best(gen, best, n);
+
+	cnt = 0;
+	fl_buf_put(&data, &cnt, sizeof(uint32_t));
+
+	for(i = 0; i < n; i++) {
+		inst.len = 0;
+		fl_ckpt_enc(&inst, best[i]);
+		if((sizeof(struct fl_chdr_t) + data.len + inst.len) > FL_ISLAND_MSG)
+			continue;
+
+		fl_buf_put(&data, inst.arr, inst.len);
+		cnt++;
+	}
+
+	memcpy(data.arr, &cnt, sizeof(uint32_t));
+	fl_ckpt_rec(&out, fl_ckpt_func_v, &data);
+
+	if((cnt == 0) || (island->wr < 0))
+		island->ndrop += cnt;
+	else {
+		do
+			ret = write(island->wr, out.arr, out.len);
+		while((ret < 0) && (errno == EINTR));
+
+		if(ret == (ssize_t)out.len)
+			island->nsent += cnt;
+		else {
+			island->ndrop += cnt;
+
+			if((ret < 0) && (errno != EAGAIN)) {
+				close(island->wr);
+				island->wr = -1;
+			}
+		}
+	}
+
+	free(out.arr);
+	free(data.arr);
+	free(inst.arr);
+}
+
+/**
+ * Receive any pending migrants from the previous island without blocking.
+ * Migrants keep the scores from their island and are only added if the
+ * generator has not seen them.
+ *   @island: The island.
+ *   @gen: The generator.
+ *   &returns: The number of migrants added.
+ */
+unsigned int fl_island_recv(struct fl_island_t *island, struct fl_gen_t *gen)
+{
+	ssize_t ret;
+	size_t off;
+	uint32_t i, cnt;
+	unsigned int nadd = 0;
+	uint8_t chunk[FL_ISLAND_MSG];
+	const uint8_t *ptr, *end;
+	struct fl_chdr_t hdr;
+	struct fl_inst_t *inst;
+	struct fl_buf_t *buf = &island->buf;
+
+	while(island->rd >= 0) {
+		ret = read(island->rd, chunk, sizeof(chunk));
+		if(ret > 0)
+			fl_buf_put(buf, chunk, ret);
+		else if((ret < 0) && (errno == EINTR))
+			continue;
+		else {
+			if((ret == 0) || (errno != EAGAIN)) {
+				close(island->rd);
+				island->rd = -1;
+			}
+
+			break;
+		}
+	}
+
+	for(off = 0; (buf->len - off) >= sizeof(struct fl_chdr_t); off += sizeof(struct fl_chdr_t) + hdr.len) {
+		memcpy(&hdr, buf->arr + off, sizeof(struct fl_chdr_t));
+		if(hdr.len > (buf->len - off - sizeof(struct fl_chdr_t)))
+			break;
+
+		ptr = buf->arr + off + sizeof(struct fl_chdr_t);
+		end = ptr + hdr.len;
+
+		if((hdr.tag != fl_ckpt_func_v) || (hdr.check != fl_ckpt_check(hdr.tag, hdr.len, ptr)) || (hdr.len < sizeof(uint32_t))) {
+			off = buf->len;
+			break;
+		}
+
+		memcpy(&cnt, ptr, sizeof(uint32_t));
+		ptr += sizeof(uint32_t);
+
+		for(i = 0; i < cnt; i++) {
+			inst = fl_ckpt_dec(&ptr, end);
+			if(inst == NULL)
+				break;
+
+			island->nrecv++;
+
+			if(fl_gen_find(gen, inst))
+				fl_inst_delete(inst);
+			else {
+				fl_gen_add(gen, inst);
+				nadd++;
+			}
+		}
+	}
+
+	memmove(buf->arr, buf->arr + off, buf->len - off);
+	buf->len -= off;
+
+	return nadd;
+}
+
+
+/**
+ * Set or clear the close-on-exec flag of a descriptor.
+ *   @fd: The descriptor.
+ *   @en: The flag.
+ *   &returns: Error.
+ */
+static char *island_cloexec(int fd, bool en)
+{
+	if(fcntl(fd, F_SETFD, en ? FD_CLOEXEC : 0) < 0)
+		return mprintf("Failed to configure island pipe. %s.", strerror(errno));
+
+	return NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef ISLAND_H
+#define ISLAND_H
+
+/*
+ * island definitions
+ */
+#define FL_ISLAND_MSG PIPE_BUF
+
+/**
+ * Island structure, one worker process in a ring of islands.
+ *   @idx, n: The island index and number of islands.
+ *   @rd, wr: The pipes from the previous and to the next island.
+ *   @buf: The receive buffer.
+ *   @nsent, nrecv, ndrop: The number of migrants sent, received, and
+ *     dropped.
+ */
+struct fl_island_t {
+	unsigned int idx, n;
+	int rd, wr;
+	struct fl_buf_t buf;
+
+	uint64_t nsent, nrecv, ndrop;
+};
+
+/*
+ * island declarations
+ */
+char *fl_island_spawn(const char *path, unsigned int n, int *status);
+
+char *fl_island_new(struct fl_island_t **island, char *const *argv);
+void fl_island_delete(struct fl_island_t *island);
+
+void fl_island_send(struct fl_island_t *island, const struct fl_gen_t *gen, unsigned int n);
+unsigned int fl_island_recv(struct fl_island_t *island, struct fl_gen_t *gen);
+
+#endif
@@ -0,0 +1,363 @@
+#include "common.h"
+
+
+/**
+ * Interval evaluation context.
+ *   @in: The input interval.
+ *   @var, dvar: The temporary intervals and derivatives.
+ *   @st: The state intervals.
+ *   @sid: The state index of the derivative.
+ */
+struct ctx_t {
+	struct fl_ival_t in;
+	struct fl_ival_t *var, *dvar, *st;
+	unsigned int sid;
+};
+
+/*
+ * local declarations
+ */
+static struct fl_ival_t ival_eval(const struct fl_expr_t *expr, struct ctx_t *ctx, struct fl_ival_t *deriv);
+static uint64_t ival_deps(const struct fl_expr_t *expr, const uint64_t *dep);
+
+static inline double ival_down(double val);
+static inline double ival_up(double val);
+static inline struct fl_ival_t ival_make(double lo, double hi);
+static inline struct fl_ival_t ival_hull(struct fl_ival_t a, struct fl_ival_t b);
+static inline struct fl_ival_t ival_add(struct fl_ival_t a, struct fl_ival_t b);
+static inline struct fl_ival_t ival_sub(struct fl_ival_t a, struct fl_ival_t b);
+static inline struct fl_ival_t ival_mul(struct fl_ival_t a, struct fl_ival_t b);
+static inline struct fl_ival_t ival_sqr(struct fl_ival_t a);
+static inline struct fl_ival_t ival_div(struct fl_ival_t a, struct fl_ival_t b);
+
+
+/**
+ * Compute the range of a signal.
+ *   @sig: The signal.
+ *   @len: The length.
+ *   &returns: The interval.
+ */
+struct fl_ival_t fl_ival_range(const double *sig, unsigned int len)
+{
+	unsigned int i;
+	struct fl_ival_t range = { 0.0, 0.0 };
+
+	if(len > 0)
+		range.lo = range.hi = sig[0];
+
+	for(i = 1; i < len; i++) {
+		range.lo = fmin(range.lo, sig[i]);
+		range.hi = fmax(range.hi, sig[i]);
+	}
+
+	return range;
+}
+
+
+/**
+ * Statically check a function with interval arithmetic, without touching
+ * the samples. The state starts at zero and its interval is widened over
+ * iterations of the update with every input drawn from the input range,
+ * until it stops growing or the iteration limit is reached. The function
+ * is rejected if a state that only feeds back into itself has a gain above
+ * one everywhere on its interval. A division that may be by zero is not
+ * rejected, since the samples may never reach the zero, and only widens
+ * its result to the whole line.
+ *   @func: The function.
+ *   @in: The input range.
+ *   @niters: The number of state iterations.
+ *   &returns: True if the function passes, false if rejected.
+ */
+bool fl_ival_check(const struct fl_func_t *func, struct fl_ival_t in, unsigned int niters)
+{
+	bool fixed;
+	unsigned int i, n;
+	uint64_t dep[func->tmp + 1], mask;
+	struct fl_ival_t var[func->tmp + 1], dvar[func->tmp + 1], st[func->st + 1], box[func->st + 1], prev, deriv;
+	struct ctx_t ctx = { in, var, dvar, st, UINT_MAX };
+
+	for(i = 0; i < func->st; i++)
+		st[i] = box[i] = ival_make(0.0, 0.0);
+
+	for(n = 0; n < niters; n++) {
+		for(i = 0; i < func->tmp; i++)
+			var[i] = ival_eval(func->let[i], &ctx, &dvar[i]);
+
+		for(i = 0; i < func->out; i++)
+			ival_eval(func->ret[i], &ctx, &deriv);
+
+		fixed = true;
+		for(i = 0; i < func->st; i++) {
+			st[i] = ival_eval(func->next[i], &ctx, &deriv);
+			prev = box[i];
+			box[i] = ival_hull(box[i], st[i]);
+			fixed &= (prev.lo == box[i].lo) && (prev.hi == box[i].hi);
+		}
+
+		if(fixed)
+			break;
+	}
+
+	for(i = 0; i < func->tmp; i++)
+		dep[i] = ival_deps(func->let[i], dep);
+
+	for(ctx.sid = 0; (ctx.sid < func->st) && (ctx.sid < 63); ctx.sid++) {
+		mask = (uint64_t)1 << ctx.sid;
+		if(ival_deps(func->next[ctx.sid], dep) != mask)
+			continue;
+
+		if(!isfinite(box[ctx.sid].lo) || !isfinite(box[ctx.sid].hi))
+			continue;
+
+		memcpy(st, box, func->st * sizeof(struct fl_ival_t));
+
+		for(i = 0; i < func->tmp; i++)
+			var[i] = ival_eval(func->let[i], &ctx, &dvar[i]);
+
+		ival_eval(func->next[ctx.sid], &ctx, &deriv);
+
+		if((deriv.lo > 1.0) || (deriv.hi < -1.0))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Evaluate an expression over intervals along with its derivative with
+ * respect to the selected state, if any.
+ *   @expr: The expression.
+ *   @ctx: The context.
+ *   @deriv: Out. The derivative interval, untouched without a state.
+ *   &returns: The value interval.
+ */
+static struct fl_ival_t ival_eval(const struct fl_expr_t *expr, struct ctx_t *ctx, struct fl_ival_t *deriv)
+{
+	struct fl_ival_t l, r, dl, dr, q;
+
+	switch(expr->type) {
+	case fl_in_v:
+		*deriv = ival_make(0.0, 0.0);
+		return ctx->in;
+
+	case fl_var_v:
+		*deriv = ctx->dvar[expr->data.id];
+		return ctx->var[expr->data.id];
+
+	case fl_st_v:
+		*deriv = ival_make((expr->data.id == ctx->sid) ? 1.0 : 0.0, (expr->data.id == ctx->sid) ? 1.0 : 0.0);
+		return ctx->st[expr->data.id];
+
+	case fl_flt_v:
+		*deriv = ival_make(0.0, 0.0);
+		return ival_make(expr->data.flt, expr->data.flt);
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		break;
+	}
+
+	l = ival_eval(expr->data.op2.left, ctx, &dl);
+	r = ival_eval(expr->data.op2.right, ctx, &dr);
+
+	switch(expr->type) {
+	case fl_add_v:
+		if(ctx->sid != UINT_MAX)
+			*deriv = ival_add(dl, dr);
+
+		return ival_add(l, r);
+
+	case fl_sub_v:
+		if(ctx->sid != UINT_MAX)
+			*deriv = ival_sub(dl, dr);
+
+		return ival_sub(l, r);
+
+	case fl_mul_v:
+		if(ctx->sid != UINT_MAX)
+			*deriv = ival_add(ival_mul(dl, r), ival_mul(l, dr));
+
+		if(fl_expr_cmp(expr->data.op2.left, expr->data.op2.right) == 0)
+			return ival_sqr(l);
+		else
+			return ival_mul(l, r);
+
+	case fl_div_v:
+		q = ival_div(l, r);
+		if(ctx->sid != UINT_MAX)
+			*deriv = ival_div(ival_sub(dl, ival_mul(q, dr)), r);
+
+		return q;
+
+	default:
+		break;
+	}
+
+	__builtin_unreachable();
+}
+
+/**
+ * Compute the states read by an expression, directly or through the
+ * temporaries.
+ *   @expr: The expression.
+ *   @dep: The state masks of the temporaries.
+ *   &returns: The state mask, with states above 63 sharing the top bit.
+ */
+static uint64_t ival_deps(const struct fl_expr_t *expr, const uint64_t *dep)
+{
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_flt_v:
+		return 0;
+
+	case fl_var_v:
+		return dep[expr->data.id];
+
+	case fl_st_v:
+		return (uint64_t)1 << ((expr->data.id < 63) ? expr->data.id : 63);
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		return ival_deps(expr->data.op2.left, dep) | ival_deps(expr->data.op2.right, dep);
+	}
+
+	__builtin_unreachable();
+}
+
+
+/**
+ * Round a bound down by at least one unit in the last place.
+ *   @val: The value.
+ *   &returns: The lower value.
+ */
+static inline double ival_down(double val)
+{
+	return isfinite(val) ? (val - (fabs(val) * 0x1p-52 + 0x1p-1074)) : val;
+}
+
+/**
+ * Round a bound up by at least one unit in the last place.
+ *   @val: The value.
+ *   &returns: The higher value.
+ */
+static inline double ival_up(double val)
+{
+	return isfinite(val) ? (val + (fabs(val) * 0x1p-52 + 0x1p-1074)) : val;
+}
+
+/**
+ * Create an interval. Invalid bounds produce the whole line. The
+ * arithmetic below rounds every result outward, so rounding never
+ * excludes the exact result.
+ *   @lo: The lower bound.
+ *   @hi: The upper bound.
+ *   &returns: The interval.
+ */
+static inline struct fl_ival_t ival_make(double lo, double hi)
+{
+	if(isnan(lo) || isnan(hi))
+		return (struct fl_ival_t){ -INFINITY, INFINITY };
+
+	return (struct fl_ival_t){ lo, hi };
+}
+
+/**
+ * Compute the hull of two intervals.
+ *   @a: The first interval.
+ *   @b: The second interval.
+ *   &returns: The hull.
+ */
+static inline struct fl_ival_t ival_hull(struct fl_ival_t a, struct fl_ival_t b)
+{
+	return ival_make(fmin(a.lo, b.lo), fmax(a.hi, b.hi));
+}
+
+/**
+ * Add two intervals.
+ *   @a: The left interval.
+ *   @b: The right interval.
+ *   &returns: The sum.
+ */
+static inline struct fl_ival_t ival_add(struct fl_ival_t a, struct fl_ival_t b)
+{
+	return ival_make(ival_down(a.lo + b.lo), ival_up(a.hi + b.hi));
+}
+
+/**
+ * Subtract two intervals.
+ *   @a: The left interval.
+ *   @b: The right interval.
+ *   &returns: The difference.
+ */
+static inline struct fl_ival_t ival_sub(struct fl_ival_t a, struct fl_ival_t b)
+{
+	return ival_make(ival_down(a.lo - b.hi), ival_up(a.hi - b.lo));
+}
+
+/**
+ * Multiply two intervals.
+ *   @a: The left interval.
+ *   @b: The right interval.
+ *   &returns: The product.
+ */
+static inline struct fl_ival_t ival_mul(struct fl_ival_t a, struct fl_ival_t b)
+{
+	double p[4];
+
+	p[0] = a.lo * b.lo;
+	p[1] = a.lo * b.hi;
+	p[2] = a.hi * b.lo;
+	p[3] = a.hi * b.hi;
+
+	if(isnan(p[0]) || isnan(p[1]) || isnan(p[2]) || isnan(p[3]))
+		return ival_make(-INFINITY, INFINITY);
+
+	return ival_make(ival_down(fmin(fmin(p[0], p[1]), fmin(p[2], p[3]))), ival_up(fmax(fmax(p[0], p[1]), fmax(p[2], p[3]))));
+}
+
+/**
+ * Square an interval.
+ *   @a: The interval.
+ *   &returns: The square.
+ */
+static inline struct fl_ival_t ival_sqr(struct fl_ival_t a)
+{
+	struct fl_ival_t r;
+
+	r = ival_mul(a, a);
+	if((a.lo <= 0.0) && (a.hi >= 0.0))
+		r.lo = 0.0;
+	else
+		r.lo = fmax(r.lo, 0.0);
+
+	return r;
+}
+
+/**
+ * Divide two intervals.
+ *   @a: The left interval.
+ *   @b: The right interval.
+ *   &returns: The quotient, or the whole line if the divisor may be zero.
+ */
+static inline struct fl_ival_t ival_div(struct fl_ival_t a, struct fl_ival_t b)
+{
+	double p[4];
+
+	if((b.lo <= 0.0) && (b.hi >= 0.0))
+		return ival_make(-INFINITY, INFINITY);
+
+	p[0] = a.lo / b.lo;
+	p[1] = a.lo / b.hi;
+	p[2] = a.hi / b.lo;
+	p[3] = a.hi / b.hi;
+
+	if(isnan(p[0]) || isnan(p[1]) || isnan(p[2]) || isnan(p[3]))
+		return ival_make(-INFINITY, INFINITY);
+
+	return ival_make(ival_down(fmin(fmin(p[0], p[1]), fmin(p[2], p[3]))), ival_up(fmax(fmax(p[0], p[1]), fmax(p[2], p[3]))));
+}
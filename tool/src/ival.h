@@ -0,0 +1,24 @@
+#ifndef IVAL_H
+#define IVAL_H
+
+/*
+ * interval definitions
+ */
+#define FL_IVALITERS 4
+
+/**
+ * Interval structure.
+ *   @lo, hi: The lower and upper bounds.
+ */
+struct fl_ival_t {
+	double lo, hi;
+};
+
+/*
+ * interval declarations
+ */
+struct fl_ival_t fl_ival_range(const double *sig, unsigned int len);
+
+bool fl_ival_check(const struct fl_func_t *func, struct fl_ival_t in, unsigned int niters);
+
+#endif
@@ -0,0 +1,180 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static void emit_body(struct fl_func_t *func, struct io_file_t file, const char *ind);
+
+
+/**
+ * Compile a set of functions into native kernels. The kernels are emitted
+ * as C, built as a shared library by the system compiler (the `CC`
+ * environment variable, or `cc`), and loaded into the process.
+ *   @jit: Ref. The JIT.
+ *   @func: The function array.
+ *   @n: The number of functions.
+ *   &returns: Error.
+ */
+char *fl_jit_new(struct fl_jit_t **jit, struct fl_func_t **func, unsigned int n)
+{
+	int status;
+	FILE *file;
+	char *err = NULL, dir[] = "/tmp/fljit.XXXXXX", src[64], lib[64], sym[32], *cmd;
+	const char *cc;
+	unsigned int i;
+	sys_pid_t pid;
+	sys_dynlib_t handle;
+	struct fl_kern_t *kern;
+
+	if(mkdtemp(dir) == NULL)
+		return mprintf("Failed to create temporary directory. %s.", strerror(errno));
+
+	sprintf(src, "%s/kern.c", dir);
+	sprintf(lib, "%s/kern.so", dir);
+
+	file = fopen(src, "w");
+	if(file == NULL) {
+		err = mprintf("Failed to open '%s'. %s.", src, strerror(errno));
+		goto clean_dir;
+	}
+
+	fl_jit_emit(func, n, io_file_wrap(file));
+	fclose(file);
+
+	cc = getenv("CC") ?: "cc";
+	cmd = mprintf("%s -O2 -fpic -shared -ffp-contract=off -fno-fast-math -o %s %s", cc, lib, src);
+	err = sys_spawn(&pid, "/bin/sh", (char *const[]){ "sh", "-c", cmd, NULL });
+	free(cmd);
+
+	if(err != NULL)
+		goto clean_src;
+
+	status = sys_wait(pid);
+	if(status != 0) {
+		err = mprintf("Failed to compile kernels with '%s' (%d).", cc, status);
+		goto clean_src;
+	}
+
+	err = sys_dynlib_open(&handle, lib);
+	if(err != NULL)
+		goto clean_lib;
+
+	kern = malloc(n * sizeof(struct fl_kern_t));
+
+	for(i = 0; i < n; i++) {
+		sprintf(sym, "fl_run_%u", i);
+		kern[i].run = sys_dynlib_sym(handle, sym);
+		if(kern[i].run == NULL)
+			break;
+
+		kern[i].score = NULL;
+		if((func[i]->in != 1) || (func[i]->out != 1))
+			continue;
+
+		sprintf(sym, "fl_score_%u", i);
+		kern[i].score = sys_dynlib_sym(handle, sym);
+		if(kern[i].score == NULL)
+			break;
+	}
+
+	if(i < n) {
+		err = mprintf("Failed to find kernel '%s'.", sym);
+		sys_dynlib_close(handle);
+		free(kern);
+		goto clean_lib;
+	}
+
+	*jit = malloc(sizeof(struct fl_jit_t));
+	(*jit)->lib = handle;
+	(*jit)->kern = kern;
+	(*jit)->nkerns = n;
+
+clean_lib:
+	unlink(lib);
+clean_src:
+	unlink(src);
+clean_dir:
+	rmdir(dir);
+
+	return err;
+}
+
+/**
+ * Delete a JIT, unloading its kernels.
+ *   @jit: The JIT.
+ */
+void fl_jit_delete(struct fl_jit_t *jit)
+{
+	sys_dynlib_close(jit->lib);
+	free(jit->kern);
+	free(jit);
+}
+
+
+/**
+ * Emit the C source for a set of functions. Each function `i` produces a
+ * run kernel `fl_run_<i>` and, if it has a single input and output, a
+ * score kernel `fl_score_<i>`. Both follow the evaluation order of
+ * `fl_func_eval` exactly.
+ *   @func: The function array.
+ *   @n: The number of functions.
+ *   @file: The output file.
+ */
+void fl_jit_emit(struct fl_func_t **func, unsigned int n, struct io_file_t file)
+{
+	unsigned int i, j;
+
+	for(i = 0; i < n; i++) {
+		hprintf(file, "void fl_run_%u(const double *restrict in, double *restrict out, double *restrict st, unsigned int len)\n{\n", i);
+		for(j = 0; j < func[i]->st; j++)
+			hprintf(file, "\tdouble s%u = st[%u];\n", j, j);
+
+		hprintf(file, "\n\tfor(unsigned int k = 0; k < len; k++, in += %u, out += %u) {\n", func[i]->in, func[i]->out);
+		hprintf(file, "\t\tconst double *x = in;\n\t\tdouble *y = out;\n\n");
+		emit_body(func[i], file, "\t\t");
+		hprintf(file, "\t}\n\n");
+
+		for(j = 0; j < func[i]->st; j++)
+			hprintf(file, "\tst[%u] = s%u;\n", j, j);
+
+		hprintf(file, "}\n\n");
+
+		if((func[i]->in != 1) || (func[i]->out != 1))
+			continue;
+
+		hprintf(file, "unsigned int fl_score_%u(const double *restrict in, const double *restrict ref, unsigned int len, double tol, double *max)\n{\n", i);
+		hprintf(file, "\tunsigned int k;\n\tdouble m = 0.0, y[1];\n");
+		for(j = 0; j < func[i]->st; j++)
+			hprintf(file, "\tdouble s%u = 0.0;\n", j);
+
+		hprintf(file, "\n\tfor(k = 0; k < len; k++) {\n\t\tconst double *x = &in[k];\n\n");
+		emit_body(func[i], file, "\t\t");
+		hprintf(file, "\n\t\tif(y[0] != y[0])\n\t\t\tbreak;\n\n");
+		hprintf(file, "\t\tm = __builtin_fmax(__builtin_fabs(y[0] - ref[k]), m);\n");
+		hprintf(file, "\t\tif(m > tol)\n\t\t\tbreak;\n\t}\n\n");
+		hprintf(file, "\t*max = m;\n\n\treturn k;\n}\n\n");
+	}
+}
+
+/**
+ * Emit the per-sample body of a function. Temporaries are constants local
+ * to the sample, outputs are written to `y`, and states are updated in
+ * order so later updates observe earlier ones.
+ *   @func: The function.
+ *   @file: The output file.
+ *   @ind: The indentation.
+ */
+static void emit_body(struct fl_func_t *func, struct io_file_t file, const char *ind)
+{
+	unsigned int i;
+
+	for(i = 0; i < func->tmp; i++)
+		hprintf(file, "%sconst double v%u = %C;\n", ind, i, fl_expr_chunk_c(func->let[i]));
+
+	for(i = 0; i < func->out; i++)
+		hprintf(file, "%sy[%u] = %C;\n", ind, i, fl_expr_chunk_c(func->ret[i]));
+
+	for(i = 0; i < func->st; i++)
+		hprintf(file, "%ss%u = %C;\n", ind, i, fl_expr_chunk_c(func->next[i]));
+}
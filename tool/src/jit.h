@@ -0,0 +1,56 @@
+#ifndef JIT_H
+#define JIT_H
+
+/**
+ * Native run kernel. Samples are interleaved by frame.
+ *   @in: The input frames.
+ *   @out: The output frames.
+ *   @st: The state.
+ *   @len: The number of frames.
+ */
+typedef void (*fl_run_f)(const double *in, double *out, double *st, unsigned int len);
+
+/**
+ * Native score kernel, starting from a zero state.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   @max: Out. The maximum error.
+ *   &returns: The number of samples accepted, equal to the length on a match.
+ */
+typedef unsigned int (*fl_score_f)(const double *in, const double *ref, unsigned int len, double tol, double *max);
+
+/**
+ * Kernel structure.
+ *   @run: The run kernel.
+ *   @score: The score kernel, null unless the function is single input and
+ *     output.
+ */
+struct fl_kern_t {
+	fl_run_f run;
+	fl_score_f score;
+};
+
+/**
+ * JIT structure.
+ *   @lib: The loaded library.
+ *   @kern: The kernel array.
+ *   @nkerns: The number of kernels.
+ */
+struct fl_jit_t {
+	sys_dynlib_t lib;
+
+	struct fl_kern_t *kern;
+	unsigned int nkerns;
+};
+
+/*
+ * jit declarations
+ */
+char *fl_jit_new(struct fl_jit_t **jit, struct fl_func_t **func, unsigned int n);
+void fl_jit_delete(struct fl_jit_t *jit);
+
+void fl_jit_emit(struct fl_func_t **func, unsigned int n, struct io_file_t file);
+
+#endif
@@ -16,9 +16,19 @@ enum fl_print_e {
 /*
  * local declarations
  */
+static void *func_alloc(struct fl_arena_t *arena, size_t nbytes);
+static struct fl_expr_t **func_slot(struct fl_func_t *func, unsigned int idx);
 static void func_chunk(struct io_file_t file, void *arg);
 
+static struct fl_expr_t *expr_alloc(void);
+static void expr_cache(struct fl_expr_t *expr);
+static void expr_refresh(struct fl_expr_t *expr);
 static void expr_chunk(struct io_file_t file, void *arg);
+static void expr_chunk_c(struct io_file_t file, void *arg);
+static bool expr_stateful(const struct fl_expr_t *expr, const bool *dep);
+static void expr_release(struct fl_expr_t *expr);
+static void expr_canon(struct fl_expr_t **expr);
+static void expr_renum(struct fl_expr_t *expr, const unsigned int *map, unsigned int first);
 
 
 /**
@@ -33,15 +43,16 @@ struct fl_func_t *fl_func_new(unsigned int in, unsigned int out, unsigned int st
 	unsigned int i;
 	struct fl_func_t *func;
 
-	func = malloc(sizeof(struct fl_func_t));
+	func = func_alloc(fl_arena_cur, sizeof(struct fl_func_t));
 	func->in = in;
 	func->tmp = 0;
 	func->out = out;
 	func->st = st;
+	func->arena = fl_arena_cur;
 
-	func->let = malloc(0);
-	func->ret = malloc(out * sizeof(void *));
-	func->next = malloc(st * sizeof(void *));
+	func->let = func_alloc(func->arena, 0);
+	func->ret = func_alloc(func->arena, out * sizeof(void *));
+	func->next = func_alloc(func->arena, st * sizeof(void *));
 
 	for(i = 0; i < out; i++)
 		func->ret[i] = fl_expr_flt(0.0);
@@ -62,15 +73,16 @@ struct fl_func_t *fl_func_copy(const struct fl_func_t *func)
 	unsigned int i;
 	struct fl_func_t *copy;
 
-	copy = malloc(sizeof(struct fl_func_t));
+	copy = func_alloc(fl_arena_cur, sizeof(struct fl_func_t));
 	copy->in = func->in;
 	copy->tmp = func->tmp;
 	copy->out = func->out;
 	copy->st = func->st;
+	copy->arena = fl_arena_cur;
 
-	copy->let = malloc(func->tmp * sizeof(void *));
-	copy->ret = malloc(func->out * sizeof(void *));
-	copy->next = malloc(func->st * sizeof(void *));
+	copy->let = func_alloc(copy->arena, func->tmp * sizeof(void *));
+	copy->ret = func_alloc(copy->arena, func->out * sizeof(void *));
+	copy->next = func_alloc(copy->arena, func->st * sizeof(void *));
 
 	for(i = 0; i < func->tmp; i++)
 		copy->let[i] = fl_expr_copy(func->let[i]);
@@ -101,6 +113,9 @@ void fl_func_delete(struct fl_func_t *func)
 	for(i = 0; i < func->st; i++)
 		fl_expr_delete(func->next[i]);
 
+	if(func->arena != NULL)
+		return;
+
 	free(func->let);
 	free(func->ret);
 	free(func->next);
@@ -108,6 +123,18 @@ void fl_func_delete(struct fl_func_t *func)
 }
 
 
+/**
+ * Allocate function storage.
+ *   @arena: Optional. The arena.
+ *   @nbytes: The number of bytes.
+ *   &returns: The allocated memory.
+ */
+static void *func_alloc(struct fl_arena_t *arena, size_t nbytes)
+{
+	return arena ? fl_arena_alloc(arena, nbytes) : malloc(nbytes);
+}
+
+
 /**
  * Add a temporary to the function.
  *   @func: The function.
@@ -115,7 +142,16 @@ void fl_func_delete(struct fl_func_t *func)
  */
 void fl_func_tmp(struct fl_func_t *func, struct fl_expr_t *expr)
 {
-	func->let = realloc(func->let, (func->tmp + 1) * sizeof(void *));
+	struct fl_expr_t **let;
+
+	if(func->arena != NULL) {
+		let = fl_arena_alloc(func->arena, (func->tmp + 1) * sizeof(void *));
+		memcpy(let, func->let, func->tmp * sizeof(void *));
+		func->let = let;
+	}
+	else
+		func->let = realloc(func->let, (func->tmp + 1) * sizeof(void *));
+
 	func->let[func->tmp++] = expr;
 }
 
@@ -228,7 +264,9 @@ uint64_t fl_func_hash(struct fl_func_t *func)
 }
 
 /**
- * Retrieve a random terminal expression.
+ * Retrieve a random terminal expression. A prefix table of terminal counts
+ * over the expression slots selects the slot by binary search, and the
+ * terminal is then found by descending a single path of the tree.
  *   @func: The function.
  *   @tmp: Ref. The maximum available temporary.
  *   @rand: Optional. The random number generator.
@@ -236,34 +274,133 @@ uint64_t fl_func_hash(struct fl_func_t *func)
  */
 struct fl_expr_t **fl_func_rand(struct fl_func_t *func, unsigned int *tmp, struct m_rand_t *rand)
 {
-	struct fl_expr_t **expr;
-	unsigned int i, rnd;
+	unsigned int i, lo, hi, rnd, nslots = func->tmp + func->out + func->st;
+	unsigned int prefix[nslots + 1];
+	struct fl_expr_t **slot;
+
+	prefix[0] = 0;
+	for(i = 0; i < nslots; i++)
+		prefix[i + 1] = prefix[i] + fl_expr_nterms(*func_slot(func, i));
+
+	rnd = m_rand_bound(rand, prefix[nslots]);
+
+	lo = 0;
+	hi = nslots;
+	while((hi - lo) > 1) {
+		i = (lo + hi) / 2;
+		if(prefix[i] <= rnd)
+			lo = i;
+		else
+			hi = i;
+	}
 
-	rnd = m_rand_u32(rand) % fl_func_nterms(func);
+	if(lo < func->tmp)
+		*tmp = lo;
+	else
+		*tmp = (func->tmp > 0) ? (func->tmp - 1) : 0;
 
-	*tmp = 0;
-	for(i = 0; i < func->tmp; i++) {
-		*tmp = i;
-		expr = fl_expr_byidx(&func->let[i], &rnd);
-		if(expr != NULL)
-			return expr;
-	}
+	rnd -= prefix[lo];
+	slot = fl_expr_byidx(func_slot(func, lo), &rnd);
+	assert(slot != NULL);
+
+	return slot;
+}
+
+/**
+ * Retrieve an expression slot of a function. Slots are numbered across the
+ * let, return, and next expressions in order.
+ *   @func: The function.
+ *   @idx: The slot index.
+ *   &returns: The expression reference.
+ */
+static struct fl_expr_t **func_slot(struct fl_func_t *func, unsigned int idx)
+{
+	if(idx < func->tmp)
+		return &func->let[idx];
+	else
+		idx -= func->tmp;
+
+	if(idx < func->out)
+		return &func->ret[idx];
+	else
+		idx -= func->out;
+
+	return &func->next[idx];
+}
+
+
+/**
+ * Check if any output of a function depends on the state, either directly
+ * or through a temporary.
+ *   @func: The function.
+ *   &returns: True if an output reads the state.
+ */
+bool fl_func_stateful(const struct fl_func_t *func)
+{
+	unsigned int i;
+	bool dep[func->tmp + 1];
+
+	for(i = 0; i < func->tmp; i++)
+		dep[i] = expr_stateful(func->let[i], dep);
 
 	for(i = 0; i < func->out; i++) {
-		expr = fl_expr_byidx(&func->ret[i], &rnd);
-		if(expr != NULL)
-			return expr;
+		if(expr_stateful(func->ret[i], dep))
+			return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * Canonicalize a function in place so that equivalent candidates hash and
+ * compare equal. Constant operations are folded, exact identities are
+ * dropped, commutative operands are sorted, and temporaries that no output
+ * or state reads are removed. Every rewrite preserves the evaluated bits,
+ * so `x + 0` is kept since it maps negative zero to positive zero.
+ *   @func: The function.
+ */
+void fl_func_canon(struct fl_func_t *func)
+{
+	uint64_t live = 0;
+	unsigned int i, n, first;
+	unsigned int map[func->tmp + 1];
+
+	for(i = 0; i < func->tmp + func->out + func->st; i++)
+		expr_canon(func_slot(func, i));
+
+	for(i = 0; i < func->out; i++)
+		live |= func->ret[i]->vars;
+
+	for(i = 0; i < func->st; i++)
+		live |= func->next[i]->vars;
+
+	for(i = func->tmp; i-- > 0; ) {
+		if(live & ((uint64_t)1 << ((i < 63) ? i : 63)))
+			live |= func->let[i]->vars;
 	}
 
-	for(i = 0; i < func->st; i++) {
-		expr = fl_expr_byidx(&func->next[i], &rnd);
-		if(expr != NULL)
-			return expr;
+	first = func->tmp;
+	for(i = n = 0; i < func->tmp; i++) {
+		if(live & ((uint64_t)1 << ((i < 63) ? i : 63))) {
+			map[i] = n;
+			func->let[n++] = func->let[i];
+		}
+		else {
+			fl_expr_delete(func->let[i]);
+			if(first == func->tmp)
+				first = i;
+		}
 	}
 
-	__builtin_unreachable();
-}
+	if(n == func->tmp)
+		return;
 
+	func->tmp = n;
+
+	for(i = 0; i < func->tmp + func->out + func->st; i++)
+		expr_renum(*func_slot(func, i), map, first);
+}
 
 /**
  * Compare two functions.
@@ -334,62 +471,6 @@ void fl_func_eval(struct fl_func_t *func, const double *in, double *out, double
 }
 
 
-/**
- * Two-operand structure.
- *   @left, right: The left and right operands.
- */
-struct fl_op2_t {
-	struct fl_expr_t *left, *right;
-};
-
-
-/**
- * Expression type enumerator.
- *   @fl_in_v: Input.
- *   @fl_var_v: Variable.
- *   @fl_st_v: State.
- *   @fl_flt_v: Constant float.
- *   @fl_add_v: Addition.
- *   @fl_sub_v: Subtraction.
- *   @fl_mul_v: Multiplication.
- *   @fl_div_v: Division.
- */
-enum fl_expr_e {
-	fl_in_v,
-	fl_var_v,
-	fl_st_v,
-	fl_flt_v,
-	fl_add_v,
-	fl_sub_v,
-	fl_mul_v,
-	fl_div_v
-};
-
-/**
- * Expression data union.
- *   @id: Identifier.
- *   @flt: Floating-point value.
- *   @op1: One-operand.
- *   @op2: Two-operands.
- */
-union fl_expr_u {
-	unsigned int id;
-	double flt;
-	struct fl_expr_t *op1;
-	struct fl_op2_t op2;
-};
-
-/**
- * Expression structure.
- *   @type: The type.
- *   @data: The data.
- */
-struct fl_expr_t {
-	enum fl_expr_e type;
-	union fl_expr_u data;
-};
-
-
 /**
  * Create a new expression.
  *   @type: The type.
@@ -400,32 +481,51 @@ struct fl_expr_t *fl_expr_new(enum fl_expr_e type, union fl_expr_u data)
 {
 	struct fl_expr_t *expr;
 
-	expr = malloc(sizeof(struct fl_expr_t));
+	expr = expr_alloc();
 	expr->type = type;
 	expr->data = data;
+	expr->canon = false;
+	expr_cache(expr);
 
 	return expr;
 }
 
 /**
- * Copy an expression.
+ * Copy an expression, carrying over the cached values.
  *   @expr: The original expression.
  *   &returns: Copied expression.
  */
 struct fl_expr_t *fl_expr_copy(const struct fl_expr_t *expr)
 {
+	struct fl_expr_t *copy;
+
+	copy = expr_alloc();
+	copy->type = expr->type;
+	copy->dirty = expr->dirty;
+	copy->canon = expr->canon;
+	copy->size = expr->size;
+	copy->nterms = expr->nterms;
+	copy->hash = expr->hash;
+	copy->vars = expr->vars;
+
 	switch(expr->type) {
-	case fl_in_v: return fl_expr_in(expr->data.id);
-	case fl_var_v: return fl_expr_var(expr->data.id);
-	case fl_st_v: return fl_expr_st(expr->data.id);
-	case fl_flt_v: return fl_expr_flt(expr->data.flt);
-	case fl_add_v: return fl_expr_add(fl_expr_copy(expr->data.op2.left), fl_expr_copy(expr->data.op2.right));
-	case fl_sub_v: return fl_expr_sub(fl_expr_copy(expr->data.op2.left), fl_expr_copy(expr->data.op2.right));
-	case fl_mul_v: return fl_expr_mul(fl_expr_copy(expr->data.op2.left), fl_expr_copy(expr->data.op2.right));
-	case fl_div_v: return fl_expr_div(fl_expr_copy(expr->data.op2.left), fl_expr_copy(expr->data.op2.right));
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+	case fl_flt_v:
+		copy->data = expr->data;
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		copy->data.op2.left = fl_expr_copy(expr->data.op2.left);
+		copy->data.op2.right = fl_expr_copy(expr->data.op2.right);
+		break;
 	}
 
-	__builtin_unreachable();
+	return copy;
 }
 
 /**
@@ -450,7 +550,86 @@ void fl_expr_delete(struct fl_expr_t *expr)
 		break;
 	}
 
-	free(expr);
+	if(!expr->arena)
+		free(expr);
+}
+
+
+/**
+ * Allocate an expression node from the bound arena or the heap.
+ *   &returns: The uninitialized expression.
+ */
+static struct fl_expr_t *expr_alloc(void)
+{
+	struct fl_expr_t *expr;
+
+	if(fl_arena_cur != NULL) {
+		expr = fl_arena_alloc(fl_arena_cur, sizeof(struct fl_expr_t));
+		expr->arena = true;
+	}
+	else {
+		expr = malloc(sizeof(struct fl_expr_t));
+		expr->arena = false;
+	}
+
+	return expr;
+}
+
+/**
+ * Compute the cached values of an expression from its children.
+ *   @expr: The expression.
+ */
+static void expr_cache(struct fl_expr_t *expr)
+{
+	struct fl_expr_t *left, *right;
+
+	expr->hash = expr->type;
+	expr->vars = 0;
+
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		expr->size = expr->nterms = 1;
+		expr->hash = mash64(expr->hash, expr->data.id);
+		if(expr->type == fl_var_v)
+			expr->vars = (uint64_t)1 << ((expr->data.id < 63) ? expr->data.id : 63);
+
+		break;
+
+	case fl_flt_v:
+		expr->size = expr->nterms = 1;
+		mash64buf(&expr->hash, &expr->data.flt, sizeof(double));
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		left = expr->data.op2.left;
+		right = expr->data.op2.right;
+		expr_refresh(left);
+		expr_refresh(right);
+
+		expr->size = left->size + right->size + 1;
+		expr->nterms = left->nterms + right->nterms;
+		expr->hash = mash64(expr->hash, mash64(left->hash, right->hash));
+		expr->vars = left->vars | right->vars;
+		break;
+	}
+
+	expr->dirty = false;
+}
+
+/**
+ * Refresh the cached values of an expression. Only the stale path is
+ * visited, so the cost is proportional to the depth of the modification.
+ *   @expr: The expression.
+ */
+static void expr_refresh(struct fl_expr_t *expr)
+{
+	if(expr->dirty)
+		expr_cache(expr);
 }
 
 
@@ -595,29 +774,81 @@ static void expr_chunk(struct io_file_t file, void *arg)
 	fl_expr_print(arg, file);
 }
 
-
 /**
- * Compute the size of an expression.
+ * Print an expression as C code. Inputs, temporaries, and states are
+ * written as `x[id]`, `v<id>`, and `s<id>`, and every operation is fully
+ * parenthesized so the evaluation order matches `fl_expr_eval`.
  *   @expr: The expression.
- *   &returns: The size.
+ *   @file: The file.
  */
-unsigned int fl_expr_size(struct fl_expr_t *expr)
+void fl_expr_print_c(const struct fl_expr_t *expr, struct io_file_t file)
 {
 	switch(expr->type) {
 	case fl_in_v:
+		hprintf(file, "x[%u]", expr->data.id);
+		break;
+
 	case fl_var_v:
+		hprintf(file, "v%u", expr->data.id);
+		break;
+
 	case fl_st_v:
+		hprintf(file, "s%u", expr->data.id);
+		break;
+
 	case fl_flt_v:
-		return 1;
+		if(isnan(expr->data.flt))
+			hprintf(file, "__builtin_nan(\"\")");
+		else if(isinf(expr->data.flt))
+			hprintf(file, "(%s__builtin_inf())", (expr->data.flt < 0.0) ? "-" : "");
+		else
+			hprintf(file, "((double)%.17g)", expr->data.flt);
+
+		break;
 
 	case fl_add_v:
+		hprintf(file, "(%C + %C)", fl_expr_chunk_c(expr->data.op2.left), fl_expr_chunk_c(expr->data.op2.right));
+		break;
+
 	case fl_sub_v:
+		hprintf(file, "(%C - %C)", fl_expr_chunk_c(expr->data.op2.left), fl_expr_chunk_c(expr->data.op2.right));
+		break;
+
 	case fl_mul_v:
+		hprintf(file, "(%C * %C)", fl_expr_chunk_c(expr->data.op2.left), fl_expr_chunk_c(expr->data.op2.right));
+		break;
+
 	case fl_div_v:
-		return fl_expr_size(expr->data.op2.left) + fl_expr_size(expr->data.op2.right) + 1;
+		hprintf(file, "(%C / %C)", fl_expr_chunk_c(expr->data.op2.left), fl_expr_chunk_c(expr->data.op2.right));
+		break;
 	}
+}
 
-	__builtin_unreachable();
+/**
+ * Create a C code chunk for an expression.
+ *   @expr: The expression.
+ *   &returns: The chunk.
+ */
+struct io_chunk_t fl_expr_chunk_c(const struct fl_expr_t *expr)
+{
+	return (struct io_chunk_t){ expr_chunk_c, (void *)expr };
+}
+static void expr_chunk_c(struct io_file_t file, void *arg)
+{
+	fl_expr_print_c(arg, file);
+}
+
+
+/**
+ * Compute the size of an expression.
+ *   @expr: The expression.
+ *   &returns: The size.
+ */
+unsigned int fl_expr_size(struct fl_expr_t *expr)
+{
+	expr_refresh(expr);
+
+	return expr->size;
 }
 
 /**
@@ -626,92 +857,241 @@ unsigned int fl_expr_size(struct fl_expr_t *expr)
  *   &returns: The number of terminal.
  */
 unsigned int fl_expr_nterms(struct fl_expr_t *expr)
+{
+	expr_refresh(expr);
+
+	return expr->nterms;
+}
+
+/**
+ * Compute a hash for the expression.
+ *   @expr: The expression.
+ *   &returns: The hash.
+ */
+uint64_t fl_expr_hash(struct fl_expr_t *expr)
+{
+	expr_refresh(expr);
+
+	return expr->hash;
+}
+
+
+/**
+ * Check if an expression depends on the state.
+ *   @expr: The expression.
+ *   @dep: The state dependence of each temporary.
+ *   &returns: True if the state is read.
+ */
+static bool expr_stateful(const struct fl_expr_t *expr, const bool *dep)
 {
 	switch(expr->type) {
 	case fl_in_v:
+	case fl_flt_v:
+		return false;
+
 	case fl_var_v:
+		return dep[expr->data.id];
+
 	case fl_st_v:
-	case fl_flt_v:
-		return 1;
+		return true;
 
 	case fl_add_v:
 	case fl_sub_v:
 	case fl_mul_v:
 	case fl_div_v:
-		return fl_expr_nterms(expr->data.op2.left) + fl_expr_nterms(expr->data.op2.right);
+		return expr_stateful(expr->data.op2.left, dep) || expr_stateful(expr->data.op2.right, dep);
 	}
 
 	__builtin_unreachable();
 }
 
+
 /**
- * Compute a hash for the expression.
+ * Retrieve a terminal by index, descending by the cached terminal counts.
+ * The nodes on the path to the terminal are marked stale so that replacing
+ * it refreshes their cached values. If the index is out of range, it is
+ * reduced by the number of terminals.
+ *   @expr: The expression reference.
+ *   @idx: Ref. The index.
+ *   &returns: The expression or null.
+ */
+struct fl_expr_t **fl_expr_byidx(struct fl_expr_t **expr, unsigned int *idx)
+{
+	struct fl_expr_t **left;
+
+	if(*idx >= fl_expr_nterms(*expr)) {
+		*idx -= (*expr)->nterms;
+		return NULL;
+	}
+
+	while((*expr)->nterms > 1) {
+		(*expr)->dirty = true;
+		(*expr)->canon = false;
+
+		left = &(*expr)->data.op2.left;
+		if(*idx < fl_expr_nterms(*left)) {
+			expr = left;
+		}
+		else {
+			*idx -= (*left)->nterms;
+			expr = &(*expr)->data.op2.right;
+		}
+	}
+
+	return expr;
+}
+
+
+/**
+ * Release the node of an expression that has been replaced by one of its
+ * children, leaving the children intact.
  *   @expr: The expression.
- *   &returns: The hash.
  */
-uint64_t fl_expr_hash(struct fl_expr_t *expr)
+static void expr_release(struct fl_expr_t *expr)
 {
-	uint64_t hash = expr->type;
+	if(!expr->arena)
+		free(expr);
+}
 
-	switch(expr->type) {
+/**
+ * Canonicalize an expression in place. Already canonical subtrees are
+ * skipped, so only the paths touched by a mutation are revisited.
+ *   @expr: The expression reference.
+ */
+static void expr_canon(struct fl_expr_t **expr)
+{
+	double val;
+	struct fl_expr_t *node = *expr, *left, *right, *tmp;
+
+	if(node->canon)
+		return;
+
+	switch(node->type) {
 	case fl_in_v:
 	case fl_var_v:
 	case fl_st_v:
-		hash = mash64(hash, expr->data.id);
-		break;
-
 	case fl_flt_v:
-		mash64buf(&hash, &expr->data.flt, sizeof(double));
+		node->canon = true;
+		return;
 
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
 		break;
+	}
+
+	expr_canon(&node->data.op2.left);
+	expr_canon(&node->data.op2.right);
+
+	left = node->data.op2.left;
+	right = node->data.op2.right;
+
+	if((left->type == fl_flt_v) && (right->type == fl_flt_v)) {
+		switch(node->type) {
+		case fl_add_v: val = left->data.flt + right->data.flt; break;
+		case fl_sub_v: val = left->data.flt - right->data.flt; break;
+		case fl_mul_v: val = left->data.flt * right->data.flt; break;
+		case fl_div_v: val = left->data.flt / right->data.flt; break;
+		default: __builtin_unreachable();
+		}
+
+		if(!isnan(val)) {
+			fl_expr_delete(left);
+			fl_expr_delete(right);
+			node->type = fl_flt_v;
+			node->data.flt = val;
+			expr_cache(node);
+			node->canon = true;
+			return;
+		}
+	}
+
+	if(((node->type == fl_add_v) || (node->type == fl_mul_v)) && (fl_expr_cmp(left, right) > 0)) {
+		tmp = left;
+		left = node->data.op2.left = right;
+		right = node->data.op2.right = tmp;
+	}
 
+	tmp = NULL;
+
+	switch(node->type) {
 	case fl_add_v:
+		if((left->type == fl_flt_v) && (left->data.flt == 0.0) && signbit(left->data.flt))
+			tmp = left;
+		else if((right->type == fl_flt_v) && (right->data.flt == 0.0) && signbit(right->data.flt))
+			tmp = right;
+
+		break;
+
 	case fl_sub_v:
+		if((right->type == fl_flt_v) && (right->data.flt == 0.0) && !signbit(right->data.flt))
+			tmp = right;
+
+		break;
+
 	case fl_mul_v:
+		if((left->type == fl_flt_v) && (left->data.flt == 1.0))
+			tmp = left;
+		else if((right->type == fl_flt_v) && (right->data.flt == 1.0))
+			tmp = right;
+
+		break;
+
 	case fl_div_v:
-		hash = mash64(hash, mash64(fl_expr_hash(expr->data.op2.left), fl_expr_hash(expr->data.op2.right)));
+		if((right->type == fl_flt_v) && (right->data.flt == 1.0))
+			tmp = right;
+
+		break;
 
+	default:
 		break;
 	}
 
-	return hash;
-}
+	if(tmp != NULL) {
+		*expr = (tmp == left) ? right : left;
+		fl_expr_delete(tmp);
+		expr_release(node);
+		return;
+	}
 
+	expr_cache(node);
+	node->canon = true;
+}
 
 /**
- * Retrieve a terminal by index.
- *   @expr: The expression reference.
- *   @idx: Ref. The index.
- *   &returns: The expression or null.
+ * Renumber the temporaries of an expression after dead temporaries have
+ * been removed. Subtrees that only read temporaries below the first
+ * removed one are unchanged and skipped.
+ *   @expr: The expression.
+ *   @map: The temporary map.
+ *   @first: The first removed temporary.
  */
-struct fl_expr_t **fl_expr_byidx(struct fl_expr_t **expr, unsigned int *idx)
+static void expr_renum(struct fl_expr_t *expr, const unsigned int *map, unsigned int first)
 {
-	switch((*expr)->type) {
+	if((expr->vars >> ((first < 63) ? first : 63)) == 0)
+		return;
+
+	switch(expr->type) {
 	case fl_in_v:
-	case fl_var_v:
 	case fl_st_v:
 	case fl_flt_v:
-		if((*idx)-- == 0)
-			return expr;
-		else
-			return NULL;
+		return;
+
+	case fl_var_v:
+		expr->data.id = map[expr->data.id];
+		break;
 
 	case fl_add_v:
 	case fl_sub_v:
 	case fl_mul_v:
 	case fl_div_v:
-		{
-			struct fl_expr_t **ret;
-
-			ret = fl_expr_byidx(&(*expr)->data.op2.left, idx);
-			if(ret == NULL)
-				ret = fl_expr_byidx(&(*expr)->data.op2.right, idx);
-
-			return ret;
-		}
+		expr_renum(expr->data.op2.left, map, first);
+		expr_renum(expr->data.op2.right, map, first);
+		break;
 	}
 
-	__builtin_unreachable();
+	expr_cache(expr);
 }
 
 
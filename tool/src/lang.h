@@ -6,10 +6,13 @@
  *   @in, tmp, out, st: The number of inputs, temporaries, outputs, and
  *     states.
  *   @let, ret, next: The set of let, return, and next expressions.
+ *   @arena: The owning arena, null if heap allocated.
  */
 struct fl_func_t {
 	unsigned int in, tmp, out, st;
 	struct fl_expr_t **let, **ret, **next;
+
+	struct fl_arena_t *arena;
 };
 
 /*
@@ -32,10 +35,81 @@ unsigned int fl_func_nterms(struct fl_func_t *func);
 uint64_t fl_func_hash(struct fl_func_t *func);
 struct fl_expr_t **fl_func_rand(struct fl_func_t *func, unsigned int *tmp, struct m_rand_t *rand);
 
+void fl_func_canon(struct fl_func_t *func);
+bool fl_func_stateful(const struct fl_func_t *func);
+
 int fl_func_cmp(const struct fl_func_t *left, const struct fl_func_t *right);
 
 void fl_func_eval(struct fl_func_t *func, const double *in, double *out, double *st);
 
+
+/**
+ * Two-operand structure.
+ *   @left, right: The left and right operands.
+ */
+struct fl_op2_t {
+	struct fl_expr_t *left, *right;
+};
+
+
+/**
+ * Expression type enumerator.
+ *   @fl_in_v: Input.
+ *   @fl_var_v: Variable.
+ *   @fl_st_v: State.
+ *   @fl_flt_v: Constant float.
+ *   @fl_add_v: Addition.
+ *   @fl_sub_v: Subtraction.
+ *   @fl_mul_v: Multiplication.
+ *   @fl_div_v: Division.
+ */
+enum fl_expr_e {
+	fl_in_v,
+	fl_var_v,
+	fl_st_v,
+	fl_flt_v,
+	fl_add_v,
+	fl_sub_v,
+	fl_mul_v,
+	fl_div_v
+};
+
+/**
+ * Expression data union.
+ *   @id: Identifier.
+ *   @flt: Floating-point value.
+ *   @op1: One-operand.
+ *   @op2: Two-operands.
+ */
+union fl_expr_u {
+	unsigned int id;
+	double flt;
+	struct fl_expr_t *op1;
+	struct fl_op2_t op2;
+};
+
+/**
+ * Expression structure.
+ *   @type: The type.
+ *   @arena: Arena allocated flag.
+ *   @dirty: Stale cache flag, set on the path to a modified subtree.
+ *   @canon: Canonical subtree flag.
+ *   @size, nterms: The cached size and number of terminals.
+ *   @hash: The cached hash.
+ *   @vars: The cached mask of referenced temporaries, with temporaries
+ *     above 63 sharing the top bit.
+ *   @data: The data.
+ */
+struct fl_expr_t {
+	enum fl_expr_e type;
+	bool arena, dirty, canon;
+
+	unsigned int size, nterms;
+	uint64_t hash, vars;
+
+	union fl_expr_u data;
+};
+
 /*
  * expression declarations
  */
@@ -58,6 +132,8 @@ struct fl_expr_t *fl_expr_div(struct fl_expr_t *left, struct fl_expr_t *right);
 
 void fl_expr_print(struct fl_expr_t *expr, struct io_file_t file);
 struct io_chunk_t fl_expr_chunk(const struct fl_expr_t *expr);
+void fl_expr_print_c(const struct fl_expr_t *expr, struct io_file_t file);
+struct io_chunk_t fl_expr_chunk_c(const struct fl_expr_t *expr);
 
 unsigned int fl_expr_size(struct fl_expr_t *expr);
 unsigned int fl_expr_nterms(struct fl_expr_t *expr);
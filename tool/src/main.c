@@ -38,29 +38,93 @@ struct ir_block_t {
 
 
 /**
- * Load an array of sample data.
+ * Load a prefix of one channel of a sound file as arrays of sample data in
+ * either or both precisions. The file is streamed, so only the selected
+ * samples of the selected channel are held in memory.
  *   @path: The path.
- *   @arr: Ref. The output array.
+ *   @chan: The channel.
+ *   @lim: The maximum number of frames.
+ *   @arr: Out. The double precision array, or null to skip.
+ *   @arrf: Out. The single precision array, or null to skip.
+ *   @len: Out. The length.
+ */
+void snd_load(const char *path, unsigned int chan, unsigned int lim, double **arr, float **arrf, unsigned int *len)
+{
+	unsigned int i, n;
+	struct fl_stream_t *stream;
+	const struct fl_block_t *block;
+
+	chkabort(fl_stream_open(&stream, path, 16384, 4));
+	if(chan >= stream->nchans)
+		fatal("File '%s' has no channel %u.", path, chan);
+
+	*len = (stream->nframes < lim) ? stream->nframes : lim;
+
+	if(arr != NULL)
+		*arr = malloc(*len * sizeof(double));
+
+	if(arrf != NULL)
+		*arrf = malloc(*len * sizeof(float));
+
+	while(((block = fl_stream_next(stream)) != NULL) && (block->pos < *len)) {
+		n = ((*len - block->pos) < block->len) ? (*len - block->pos) : block->len;
+
+		if(arr != NULL)
+			memcpy(*arr + block->pos, block->ch[chan], n * sizeof(double));
+
+		if(arrf != NULL) {
+			for(i = 0; i < n; i++)
+				(*arrf)[block->pos + i] = block->ch[chan][i];
+		}
+	}
+
+	fl_stream_close(stream);
+}
+
+
+/**
+ * Match list structure.
+ *   @func: The function array.
  *   @len: The length.
  */
-void snd_load(const char *path, double **arr, unsigned int *len)
+struct match_t {
+	struct fl_func_t **func;
+	unsigned int len;
+};
+
+/**
+ * Report a search match, keeping a copy of the function since the
+ * instance may later be evicted.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of accepted samples.
+ *   @arg: The match list.
+ */
+static void test1_report(struct fl_inst_t *inst, double max, unsigned int idx, void *arg)
 {
-	SNDFILE *file;
-	SF_INFO info;
+	struct match_t *match = arg;
 
-	info.format = 0;
-	file = sf_open(path, SFM_READ, &info);
-	if(file == NULL)
-		fatal("Cannot open file '%s'.", path);
+	printf("match: %g\n", max);
+	fl_func_dump(inst->func);
 
-	if(info.channels > 1)
-		fatal("File '%s' has more than 1 channel.", path);
+	match->func = realloc(match->func, (match->len + 1) * sizeof(void *));
+	match->func[match->len++] = fl_func_copy(inst->func);
+}
 
-	*arr = malloc(info.frames * sizeof(double));
-	*len = info.frames;
+/**
+ * Compute the test reference of a stream block, carrying the previous
+ * output across blocks.
+ *   @block: The block.
+ *   @ref: Out. The reference.
+ *   @arg: The previous reference sample.
+ */
+static void test1_ref(const struct fl_block_t *block, double *ref, void *arg)
+{
+	unsigned int i;
+	double *prev = arg;
 
-	sf_readf_double(file, *arr, *len);
-	sf_close(file);
+	for(i = 0; i < block->len; i++)
+		ref[i] = *prev = 1.6 * block->ch[0][i] + *prev;
 }
 
 
@@ -69,12 +133,14 @@ void snd_load(const char *path, double **arr, unsigned int *len)
  */
 void test1(void)
 {
-	double *in, *ref, *cmp;
-	unsigned int i, k, len;
+	double *in, *ref;
+	float *inf, *reff;
+	unsigned int i, len;
 
-	snd_load("sample.flac", &in, &len);
+	/* search over a bounded prefix, validating matches over the whole file */
+	snd_load("sample.flac", 0, 1 << 16, &in, &inf, &len);
 	ref = malloc(len * sizeof(double));
-	cmp = malloc(len * sizeof(double));
+	reff = malloc(len * sizeof(float));
 
 	//memcpy(in, (double[]){ 0,3, 5, 6}, 4*sizeof(double));
 	//len = 4;
@@ -83,10 +149,13 @@ void test1(void)
 	for(i = 1; i < len; i++)
 		ref[i] = 1.6 * in[i] + ref[i-1];
 
+	for(i = 0; i < len; i++)
+		reff[i] = ref[i];
+
 	//printf("ref: %f %f %f %f\n", ref[0], ref[1], ref[2], ref[3]);
 
 	struct fl_gen_t *gen;
-	struct m_rand_t rand = m_rand_init(0);
+	struct fl_search_t *search;
 	struct fl_weight_t weight = {
 		.add = 8.0f,
 		.sub = 2.0f,
@@ -97,43 +166,202 @@ void test1(void)
 	fl_weight_norm(&weight);
 
 	gen = fl_gen_new();
-	fl_gen_const(gen, 1.6);
 	fl_gen_add(gen, fl_inst_new(fl_func_new(1, 1, 1)));
 
-	double s[1];
+	struct match_t match = { malloc(0), 0 };
+
+	struct fl_fit_t *fit;
+	struct fl_cache_t *cache;
+	struct fl_screen_t *screen;
+
+	fit = fl_fit_new(in, ref, (len < 256) ? len : 256, 4);
+	screen = fl_screen_new(in, ref, len, 32, (unsigned int[]){ 256, 4096 }, 2);
+	search = fl_search_new(gen, &weight, in, ref, len, 0.001, screen, fit);
+	fl_search_cap(search, 1 << 16);
+	fl_search_prec(search, fl_prec_mixed_v, inf, reff);
+	chkabort(fl_cache_open(&cache, "fitness.cache"));
+	fl_search_cache(search, cache);
+
+	struct fl_inst_t *inst;
+	struct fl_ckpt_t *ckpt;
 
-	for(k = 0; k < 1000000; k++) {
-		struct fl_inst_t *inst;
-		double diff, max = 0.0;
+	chkabort(fl_ckpt_open_search(&ckpt, "search.ckpt", 60000000, search));
 
-		inst = fl_gen_trial(gen, &weight, &rand);
-		if(inst == NULL)
-			continue;
+	/* the search only reports new matches, so pick up restored ones */
+	for(i = 0; i < search->npop; i++) {
+		inst = fl_search_get(search, i);
+		if(inst->idx == len)
+			test1_report(inst, inst->max, inst->idx, &match);
+	}
+
+	while(search->ntrials < 1000000) {
+		fl_search_run(search, sysconf(_SC_NPROCESSORS_ONLN), 50000, 0, test1_report, &match);
+		chkabort(fl_ckpt_poll(ckpt));
+	}
 
-		s[0] = 0.0;
-		for(i = 0; i < len; i++) {
-			fl_func_eval(inst->func, &in[i], &cmp[i], s);
-			if(isnan(cmp[i]))
-				break;
+	chkabort(fl_ckpt_save(ckpt));
+	fl_ckpt_close(ckpt);
+	fl_screen_print(screen, search->reject, io_file_wrap(stdout));
 
-			diff = fabs(cmp[i] - ref[i]);
-			max = fmax(diff, max);
-			if(max > 0.001)
-				break;
+	if(match.len > 0) {
+		double prev = 0.0, max[match.len];
+		uint64_t idx[match.len];
+		struct fl_jit_t *jit;
+		struct fl_prog_t *prog[match.len];
+		struct fl_stream_t *stream;
+
+		chkabort(fl_jit_new(&jit, match.func, match.len));
+
+		for(i = 0; i < match.len; i++) {
+			if(jit->kern[i].score(in, ref, len, 0.001, &max[i]) == len)
+				printf("native match %u: %g\n", i, max[i]);
 		}
 
-		if(i == len) {
-			printf("match: %g\n", max);
-			//printf("HERE! %g : %f %f %f %f\n", max, cmp[0], cmp[1], cmp[2], cmp[3]);
-			fl_func_dump(inst->func);
+		fl_jit_delete(jit);
+
+		for(i = 0; i < match.len; i++)
+			prog[i] = fl_prog_new(match.func[i]);
+
+		chkabort(fl_stream_open(&stream, "sample.flac", 16384, 4));
+		fl_stream_score(stream, prog, match.len, 0, test1_ref, &prev, 0.001, max, idx);
+
+		for(i = 0; i < match.len; i++) {
+			if(idx[i] == stream->nframes)
+				printf("full match %u: %g\n", i, max[i]);
+
+			fl_prog_delete(prog[i]);
 		}
+
+		fl_stream_close(stream);
 	}
 
+	for(i = 0; i < match.len; i++)
+		fl_func_delete(match.func[i]);
+
+	free(match.func);
+	fl_search_delete(search);
+	fl_cache_close(cache);
+	fl_screen_delete(screen);
+	fl_fit_delete(fit);
+
 	fl_gen_delete(gen);
 
 	free(in);
 	free(ref);
-	free(cmp);
+	free(inf);
+	free(reff);
+}
+
+/**
+ * Island search structure.
+ *   @island: The island.
+ *   @gen: The generator.
+ *   @weight: The weights.
+ *   @rand: The random number generator.
+ *   @ckpt: The checkpoint.
+ *   @len: The signal length.
+ *   @ntrials: The number of trials.
+ */
+struct isle_t {
+	struct fl_island_t *island;
+	struct fl_gen_t *gen;
+	struct fl_weight_t weight;
+	struct m_rand_t rand;
+	struct fl_ckpt_t *ckpt;
+
+	unsigned int len;
+	uint64_t ntrials;
+};
+
+/**
+ * Fetch the next island trial, migrating periodically.
+ *   @arg: The island search.
+ *   &returns: The instance, or null when the trials are exhausted.
+ */
+static struct fl_inst_t *test3_fetch(void *arg)
+{
+	struct isle_t *isle = arg;
+	struct fl_inst_t *inst;
+
+	while(isle->ntrials < 1000000) {
+		if((isle->ntrials % 10000) == 0) {
+			chkabort(fl_ckpt_poll(isle->ckpt));
+			fl_island_recv(isle->island, isle->gen);
+			fl_island_send(isle->island, isle->gen, 8);
+		}
+
+		isle->ntrials++;
+
+		inst = fl_gen_trial(isle->gen, &isle->weight, &isle->rand);
+		if(inst != NULL)
+			return inst;
+	}
+
+	return NULL;
+}
+
+/**
+ * Score an island trial, printing matches.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of accepted samples.
+ *   @arg: The island search.
+ */
+static void test3_report(struct fl_inst_t *inst, double max, unsigned int idx, void *arg)
+{
+	struct isle_t *isle = arg;
+
+	fl_inst_score(inst, max, idx);
+	if(idx < isle->len)
+		return;
+
+	printf("island %u match: %g\n", isle->island->idx, max);
+	fl_func_dump(inst->func);
+}
+
+void test3(struct fl_island_t *island)
+{
+	char *path;
+	double *in, *ref;
+	unsigned int i, len;
+	struct fl_batch_t *batch;
+	struct isle_t isle;
+
+	snd_load("sample.flac", 0, UINT_MAX, &in, NULL, &len);
+	ref = malloc(len * sizeof(double));
+
+	ref[0] = 1.6*in[0];
+	for(i = 1; i < len; i++)
+		ref[i] = 1.6 * in[i] + ref[i-1];
+
+	isle.island = island;
+	isle.gen = fl_gen_new();
+	isle.weight = (struct fl_weight_t){ .add = 8.0f, .sub = 2.0f, .mul = 8.0f, .div = 1.0f };
+	isle.rand = m_rand_stream(0, island->idx);
+	isle.len = len;
+	isle.ntrials = 0;
+
+	fl_weight_norm(&isle.weight);
+	fl_gen_cap(isle.gen, 4096);
+	fl_gen_add(isle.gen, fl_inst_new(fl_func_new(1, 1, 1)));
+
+	path = mprintf("island%u.ckpt", island->idx);
+	chkabort(fl_ckpt_open(&isle.ckpt, path, 60000000, isle.gen, &isle.rand, &isle.ntrials));
+	free(path);
+
+	/* a single lane scores every trial before the next one is added */
+	batch = fl_batch_new(1, in, ref, len, 0.001, NULL);
+	fl_batch_run(batch, test3_fetch, test3_report, &isle);
+	fl_batch_delete(batch);
+
+	chkabort(fl_ckpt_save(isle.ckpt));
+	fl_ckpt_close(isle.ckpt);
+
+	printf("island %u: sent %lu, received %lu, dropped %lu\n", island->idx, island->nsent, island->nrecv, island->ndrop);
+
+	fl_gen_delete(isle.gen);
+	free(in);
+	free(ref);
 }
 
 void test2(void)
@@ -152,9 +380,8 @@ void test2(void)
 	cir_connect(&res2->port[1], &gnd->port[0]);
 
 	{
-		struct r_sys_t *sys, *iter;
+		struct r_sys_t *sys;
 		struct rvec_var_t *var;
-		unsigned int i, j;
 
 		sys = cir_system(in);
 		var = rvec_gather_sys(sys);
@@ -165,45 +392,28 @@ void test2(void)
 		if(var->len != r_sys_cnt(sys))
 			fatal("Invalid system of equations: %d variables for %d equations.", var->len, r_sys_cnt(sys));
 
-		struct rmat_expr_t *mat;
+		struct rmat_sparse_t *mat;
 		struct rvec_expr_t *vec, *res;
 
-		vec = rvec_expr_new(var->len);
-		mat = rmat_expr_new(var->len, var->len);
-
 		printf("%u::%u\n", var->len, r_sys_cnt(sys));
-		for(iter = sys, j = 0; iter != NULL; iter = iter->next, j++) {
-			for(i = 0; i < var->len; i++)
-				r_expr_set(rmat_expr_get(mat, j, i), r_fold_expr_clr(r_deriv_expr(iter->rel->left, var->arr[i])));
-
-			r_expr_set(&vec->arr[j], r_fold_expr_clr(r_expr_neg(r_const_expr(iter->rel->left))));
-		}
-
-		rmat_expr_dump(mat); printf("\n");
-
-		struct rmat_expr_t *inv;
+		chkabort(rmat_sparse_sys(&mat, &vec, sys, var));
 
-		inv = rmat_expr_inv(mat);
-		inv = rmat_fold_expr_clr(inv);
-		rmat_expr_dump(inv); printf("\n");
-		//printf("%C\n", r_expr_chunk(inv));
+		rmat_sparse_dump(mat); printf("\n");
 
 		rvec_expr_dump(vec); printf("\n");
 
-		res = rvec_fold_expr_clr(rvec_expr_mul(inv, vec));
+		int out_idx = rvec_var_idx(var, "Out"), s1_idx = rvec_var_idx(var, "s1");
 
-		struct r_expr_t *calc = NULL, *s1 = NULL;
+		if((out_idx < 0) || (s1_idx < 0))
+			fatal("Missing output or state variable.");
 
-		for(i = 0; i < res->len; i++) {
-			res->arr[i] = r_fold_expr_clr(res->arr[i]);
+		/* only the output and the next state are needed */
+		res = rmat_sparse_solve(mat, vec, (unsigned int[]){ out_idx, s1_idx }, 2);
 
-			if(strcmp(var->arr[i]->id, "Out") == 0)
-				calc = res->arr[i];
-			else if(strcmp(var->arr[i]->id, "s1") == 0)
-				s1 = res->arr[i];
+		struct r_expr_t *calc = res->arr[0], *s1 = res->arr[1];
 
-			printf("%s: %C\n", var->arr[i]->id, r_expr_chunk(res->arr[i]));
-		}
+		printf("Out: %C\n", r_expr_chunk(calc));
+		printf("s1: %C\n", r_expr_chunk(s1));
 
 		struct r_env_t *env;
 
@@ -229,8 +439,7 @@ void test2(void)
 
 		r_env_delete(env);
 
-		rmat_expr_delete(mat);
-		rmat_expr_delete(inv);
+		rmat_sparse_delete(mat);
 		rvec_expr_delete(vec);
 		rvec_expr_delete(res);
 		rvec_var_delete(var);
@@ -253,6 +462,34 @@ void test2(void)
  */
 int main(int argc, char **argv)
 {
+	if((argc >= 2) && (strcmp(argv[1], "island") == 0)) {
+		struct fl_island_t *island;
+
+		chkabort(fl_island_new(&island, argv + 2));
+		test3(island);
+		fl_island_delete(island);
+
+		return 0;
+	}
+	else if((argc >= 2) && (strcmp(argv[1], "islands") == 0)) {
+		unsigned int i;
+		long n = (argc >= 3) ? strtol(argv[2], NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+
+		if(n < 1)
+			fatal("The number of islands must be at least one.");
+
+		int status[n];
+
+		chkabort(fl_island_spawn("/proc/self/exe", n, status));
+
+		for(i = 0; i < n; i++) {
+			if(status[i] != 0)
+				fprintf(stderr, "island %u failed with status %d\n", i, status[i]);
+		}
+
+		return 0;
+	}
+
 	dat_cir1();
 
 	/*
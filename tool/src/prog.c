@@ -0,0 +1,621 @@
+#include "common.h"
+
+/*
+ * vector definitions
+ */
+#define LANES 4
+#define NVECS (FL_BLOCK / LANES)
+
+typedef double vec_t __attribute__((vector_size(LANES * sizeof(double))));
+
+#define LANESF (2 * LANES)
+#define NVECSF (FL_BLOCK / LANESF)
+
+typedef float vecf_t __attribute__((vector_size(LANESF * sizeof(float))));
+
+/*
+ * virtual register definitions
+ */
+#define REG_PURE (1u << 30)
+#define REG_IMPURE (1u << 31)
+#define REG_MASK (REG_PURE - 1)
+
+
+/**
+ * Virtual operation structure.
+ *   @code: The opcode.
+ *   @dst, left, right: The destination, left, and right virtual registers.
+ *   @pure: Independent of the state flag.
+ */
+struct vop_t {
+	enum fl_op_e code;
+	unsigned int dst, left, right;
+	bool pure;
+};
+
+/**
+ * Compiler structure.
+ *   @prog: The program.
+ *   @cnst: The constant array.
+ *   @ncnsts: The number of constants.
+ *   @pure: The purity of each temporary.
+ *   @vop: The virtual operation array.
+ *   @nvops: The number of virtual operations.
+ *   @base: The first scratch register.
+ *   @npure, top, max: The number of pure scratch registers, and the current
+ *     and maximum impure scratch register.
+ */
+struct compile_t {
+	struct fl_prog_t *prog;
+
+	double *cnst;
+	unsigned int ncnsts;
+
+	bool *pure;
+	struct vop_t *vop;
+	unsigned int nvops;
+
+	unsigned int base;
+	unsigned int npure, top, max;
+};
+
+/*
+ * local declarations
+ */
+static void compile_scan(struct compile_t *comp, const struct fl_expr_t *expr);
+static unsigned int compile_expr(struct compile_t *comp, const struct fl_expr_t *expr, int dst, bool *pure);
+static void compile_op(struct compile_t *comp, enum fl_op_e code, unsigned int dst, unsigned int left, unsigned int right, bool pure);
+static uint16_t compile_reg(struct compile_t *comp, unsigned int reg);
+
+static void prog_scalar(const struct fl_prog_t *prog, const double *in, double *out, double *st, unsigned int len);
+static void prog_pure(const struct fl_prog_t *prog, vec_t *blk);
+static inline void prog_exec(const struct fl_op_t *op, const struct fl_op_t *end, double *reg, unsigned int stride);
+
+static void prog_scalarf(const struct fl_prog_t *prog, const float *in, float *out, float *st, unsigned int len);
+static void prog_puref(const struct fl_prog_t *prog, vecf_t *blk);
+static inline void prog_execf(const struct fl_op_t *op, const struct fl_op_t *end, float *reg, unsigned int stride);
+
+
+/**
+ * Compile a function into a program.
+ *   @func: The function.
+ *   &returns: The program.
+ */
+struct fl_prog_t *fl_prog_new(const struct fl_func_t *func)
+{
+	bool pure;
+	unsigned int i, n;
+	struct fl_prog_t *prog;
+	struct compile_t comp;
+
+	prog = malloc(sizeof(struct fl_prog_t));
+	prog->in = func->in;
+	prog->tmp = func->tmp;
+	prog->out = func->out;
+	prog->st = func->st;
+	prog->nops = func->tmp + func->out + func->st;
+
+	comp.prog = prog;
+	comp.cnst = malloc(0);
+	comp.ncnsts = 0;
+
+	for(i = 0; i < func->tmp; i++)
+		compile_scan(&comp, func->let[i]);
+
+	for(i = 0; i < func->out; i++)
+		compile_scan(&comp, func->ret[i]);
+
+	for(i = 0; i < func->st; i++)
+		compile_scan(&comp, func->next[i]);
+
+	comp.pure = malloc(func->tmp * sizeof(bool));
+	memset(comp.pure, 0x00, func->tmp * sizeof(bool));
+	comp.vop = malloc(prog->nops * sizeof(struct vop_t));
+	comp.nvops = 0;
+	comp.base = func->in + func->tmp + func->st + func->out + comp.ncnsts;
+	comp.npure = comp.top = comp.max = 0;
+
+	for(i = 0; i < func->tmp; i++)
+		compile_expr(&comp, func->let[i], func->in + i, &comp.pure[i]);
+
+	for(i = 0; i < func->out; i++)
+		compile_expr(&comp, func->ret[i], func->in + func->tmp + func->st + i, &pure);
+
+	for(i = 0; i < func->st; i++)
+		compile_expr(&comp, func->next[i], func->in + func->tmp + i, &pure);
+
+	prog->nregs = comp.base + comp.npure + comp.max;
+	if(prog->nregs > UINT16_MAX)
+		fatal("Program requires too many registers (%u).", prog->nregs);
+
+	prog->op = malloc(comp.nvops * sizeof(struct fl_op_t));
+	prog->nops = 0;
+
+	for(n = 0; n < 2; n++) {
+		for(i = 0; i < comp.nvops; i++) {
+			if(comp.vop[i].pure != (n == 0))
+				continue;
+
+			prog->op[prog->nops++] = (struct fl_op_t){ comp.vop[i].code, compile_reg(&comp, comp.vop[i].dst), compile_reg(&comp, comp.vop[i].left), compile_reg(&comp, comp.vop[i].right) };
+		}
+
+		if(n == 0)
+			prog->npure = prog->nops;
+	}
+
+	prog->init = malloc(prog->nregs * sizeof(double));
+
+	for(i = 0; i < prog->nregs; i++)
+		prog->init[i] = 0.0;
+
+	memcpy(prog->init + comp.base - comp.ncnsts, comp.cnst, comp.ncnsts * sizeof(double));
+
+	prog->initf = malloc(prog->nregs * sizeof(float));
+	for(i = 0; i < prog->nregs; i++)
+		prog->initf[i] = prog->init[i];
+
+	free(comp.cnst);
+	free(comp.pure);
+	free(comp.vop);
+
+	return prog;
+}
+
+/**
+ * Delete a program.
+ *   @prog: The program.
+ */
+void fl_prog_delete(struct fl_prog_t *prog)
+{
+	free(prog->init);
+	free(prog->initf);
+	free(prog->op);
+	free(prog);
+}
+
+
+/**
+ * Scan an expression for constants and operations.
+ *   @comp: The compiler.
+ *   @expr: The expression.
+ */
+static void compile_scan(struct compile_t *comp, const struct fl_expr_t *expr)
+{
+	unsigned int i;
+
+	switch(expr->type) {
+	case fl_in_v:
+	case fl_var_v:
+	case fl_st_v:
+		break;
+
+	case fl_flt_v:
+		for(i = 0; i < comp->ncnsts; i++) {
+			if(memcmp(&comp->cnst[i], &expr->data.flt, sizeof(double)) == 0)
+				return;
+		}
+
+		comp->cnst = realloc(comp->cnst, (comp->ncnsts + 1) * sizeof(double));
+		comp->cnst[comp->ncnsts++] = expr->data.flt;
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		compile_scan(comp, expr->data.op2.left);
+		compile_scan(comp, expr->data.op2.right);
+		comp->prog->nops++;
+		break;
+	}
+}
+
+/**
+ * Compile an expression.
+ *   @comp: The compiler.
+ *   @expr: The expression.
+ *   @dst: The destination register, or negative to allocate a scratch
+ *     register.
+ *   @pure: Out. Independent of the state flag.
+ *   &returns: The virtual register holding the result.
+ */
+static unsigned int compile_expr(struct compile_t *comp, const struct fl_expr_t *expr, int dst, bool *pure)
+{
+	bool lpure, rpure;
+	unsigned int i, reg, top, left, right;
+	struct fl_prog_t *prog = comp->prog;
+
+	switch(expr->type) {
+	case fl_in_v:
+		reg = expr->data.id;
+		*pure = true;
+		break;
+
+	case fl_var_v:
+		reg = prog->in + expr->data.id;
+		*pure = comp->pure[expr->data.id];
+		break;
+
+	case fl_st_v:
+		reg = prog->in + prog->tmp + expr->data.id;
+		*pure = false;
+		break;
+
+	case fl_flt_v:
+		for(i = 0; memcmp(&comp->cnst[i], &expr->data.flt, sizeof(double)) != 0; i++);
+
+		reg = comp->base - comp->ncnsts + i;
+		*pure = true;
+		break;
+
+	case fl_add_v:
+	case fl_sub_v:
+	case fl_mul_v:
+	case fl_div_v:
+		top = comp->top;
+		left = compile_expr(comp, expr->data.op2.left, -1, &lpure);
+		right = compile_expr(comp, expr->data.op2.right, -1, &rpure);
+		comp->top = top;
+
+		*pure = lpure && rpure;
+
+		if(dst >= 0)
+			reg = dst;
+		else if(*pure)
+			reg = REG_PURE | comp->npure++;
+		else {
+			reg = REG_IMPURE | comp->top++;
+			if(comp->top > comp->max)
+				comp->max = comp->top;
+		}
+
+		compile_op(comp, fl_op_add_v + (expr->type - fl_add_v), reg, left, right, *pure);
+
+		return reg;
+
+	default:
+		__builtin_unreachable();
+	}
+
+	if((dst >= 0) && (dst != reg))
+		compile_op(comp, fl_op_mov_v, dst, reg, reg, *pure);
+
+	return reg;
+}
+
+/**
+ * Append an operation to the program.
+ *   @comp: The compiler.
+ *   @code: The opcode.
+ *   @dst: The destination register.
+ *   @left: The left register.
+ *   @right: The right register.
+ *   @pure: Independent of the state flag.
+ */
+static void compile_op(struct compile_t *comp, enum fl_op_e code, unsigned int dst, unsigned int left, unsigned int right, bool pure)
+{
+	struct fl_prog_t *prog = comp->prog;
+
+	/* state updates belong to the recurrence */
+	if((dst >= (prog->in + prog->tmp)) && (dst < (prog->in + prog->tmp + prog->st)))
+		pure = false;
+
+	comp->vop[comp->nvops++] = (struct vop_t){ code, dst, left, right, pure };
+}
+
+/**
+ * Map a virtual register onto the register file. Pure scratch registers are
+ * never reused so that the pure operations may be hoisted ahead of the
+ * impure ones.
+ *   @comp: The compiler.
+ *   @reg: The virtual register.
+ *   &returns: The register.
+ */
+static uint16_t compile_reg(struct compile_t *comp, unsigned int reg)
+{
+	if(reg & REG_IMPURE)
+		return comp->base + comp->npure + (reg & REG_MASK);
+	else if(reg & REG_PURE)
+		return comp->base + (reg & REG_MASK);
+	else
+		return reg;
+}
+
+
+/**
+ * Evaluate a program on a single sample.
+ *   @prog: The program.
+ *   @in: The input.
+ *   @out: The output.
+ *   @st: The state.
+ */
+void fl_prog_eval(const struct fl_prog_t *prog, const double *in, double *out, double *st)
+{
+	prog_scalar(prog, in, out, st, 1);
+}
+
+/**
+ * Run a program over a buffer of samples. Operations that do not depend on
+ * the state are evaluated across a block of samples at once, leaving only
+ * the recurrence to the per-sample loop.
+ *   @prog: The program.
+ *   @in: The input buffer, `prog->in` values per sample.
+ *   @out: The output buffer, `prog->out` values per sample.
+ *   @st: The state, carried across samples.
+ *   @len: The number of samples.
+ */
+void fl_prog_run(const struct fl_prog_t *prog, const double *in, double *out, double *st, unsigned int len)
+{
+	unsigned int i, j, k, n, sreg, oreg;
+
+	if(prog->nregs > 1024) {
+		prog_scalar(prog, in, out, st, len);
+		return;
+	}
+
+	vec_t blk[prog->nregs * NVECS];
+	double *reg = (double *)blk;
+
+	sreg = prog->in + prog->tmp;
+	oreg = sreg + prog->st;
+
+	for(i = 0; i < prog->nregs; i++) {
+		for(k = 0; k < FL_BLOCK; k++)
+			reg[i * FL_BLOCK + k] = prog->init[i];
+	}
+
+	for(i = 0; i < len; i += n) {
+		n = ((len - i) < FL_BLOCK) ? (len - i) : FL_BLOCK;
+
+		for(j = 0; j < prog->in; j++) {
+			for(k = 0; k < n; k++)
+				reg[j * FL_BLOCK + k] = in[(i + k) * prog->in + j];
+
+			for(; k < FL_BLOCK; k++)
+				reg[j * FL_BLOCK + k] = 0.0;
+		}
+
+		prog_pure(prog, blk);
+
+		if(prog->npure < prog->nops) {
+			for(k = 0; k < n; k++) {
+				for(j = 0; j < prog->st; j++)
+					reg[(sreg + j) * FL_BLOCK + k] = st[j];
+
+				prog_exec(prog->op + prog->npure, prog->op + prog->nops, reg + k, FL_BLOCK);
+
+				for(j = 0; j < prog->st; j++)
+					st[j] = reg[(sreg + j) * FL_BLOCK + k];
+			}
+		}
+
+		for(k = 0; k < n; k++) {
+			for(j = 0; j < prog->out; j++)
+				out[(i + k) * prog->out + j] = reg[(oreg + j) * FL_BLOCK + k];
+		}
+	}
+}
+
+/**
+ * Run a program over a buffer of samples in single precision. Every
+ * operation of the program rounds to single precision, and the pure
+ * operations are evaluated twice as many samples at a time. Constants are
+ * rounded once when compiled, so any folded while canonicalizing or
+ * fitting the function were computed in double precision, and the result
+ * can differ slightly from a float32 target evaluating the unfolded
+ * expression.
+ *   @prog: The program.
+ *   @in: The input buffer, `prog->in` values per sample.
+ *   @out: The output buffer, `prog->out` values per sample.
+ *   @st: The state, carried across samples.
+ *   @len: The number of samples.
+ */
+void fl_prog_runf(const struct fl_prog_t *prog, const float *in, float *out, float *st, unsigned int len)
+{
+	unsigned int i, j, k, n, sreg, oreg;
+
+	if(prog->nregs > 1024) {
+		prog_scalarf(prog, in, out, st, len);
+		return;
+	}
+
+	vecf_t blk[prog->nregs * NVECSF];
+	float *reg = (float *)blk;
+
+	sreg = prog->in + prog->tmp;
+	oreg = sreg + prog->st;
+
+	for(i = 0; i < prog->nregs; i++) {
+		for(k = 0; k < FL_BLOCK; k++)
+			reg[i * FL_BLOCK + k] = prog->initf[i];
+	}
+
+	for(i = 0; i < len; i += n) {
+		n = ((len - i) < FL_BLOCK) ? (len - i) : FL_BLOCK;
+
+		for(j = 0; j < prog->in; j++) {
+			for(k = 0; k < n; k++)
+				reg[j * FL_BLOCK + k] = in[(i + k) * prog->in + j];
+
+			for(; k < FL_BLOCK; k++)
+				reg[j * FL_BLOCK + k] = 0.0f;
+		}
+
+		prog_puref(prog, blk);
+
+		if(prog->npure < prog->nops) {
+			for(k = 0; k < n; k++) {
+				for(j = 0; j < prog->st; j++)
+					reg[(sreg + j) * FL_BLOCK + k] = st[j];
+
+				prog_execf(prog->op + prog->npure, prog->op + prog->nops, reg + k, FL_BLOCK);
+
+				for(j = 0; j < prog->st; j++)
+					st[j] = reg[(sreg + j) * FL_BLOCK + k];
+			}
+		}
+
+		for(k = 0; k < n; k++) {
+			for(j = 0; j < prog->out; j++)
+				out[(i + k) * prog->out + j] = reg[(oreg + j) * FL_BLOCK + k];
+		}
+	}
+}
+
+/**
+ * Run a program one sample at a time.
+ *   @prog: The program.
+ *   @in: The input buffer.
+ *   @out: The output buffer.
+ *   @st: The state.
+ *   @len: The number of samples.
+ */
+static void prog_scalar(const struct fl_prog_t *prog, const double *in, double *out, double *st, unsigned int len)
+{
+	unsigned int i, j;
+	double reg[prog->nregs], *ret;
+
+	memcpy(reg, prog->init, prog->nregs * sizeof(double));
+	memcpy(reg + prog->in + prog->tmp, st, prog->st * sizeof(double));
+
+	ret = reg + prog->in + prog->tmp + prog->st;
+
+	for(i = 0; i < len; i++) {
+		for(j = 0; j < prog->in; j++)
+			reg[j] = *in++;
+
+		prog_exec(prog->op, prog->op + prog->nops, reg, 1);
+
+		for(j = 0; j < prog->out; j++)
+			*out++ = ret[j];
+	}
+
+	memcpy(st, reg + prog->in + prog->tmp, prog->st * sizeof(double));
+}
+
+/**
+ * Execute the pure operations of a program across a block.
+ *   @prog: The program.
+ *   @blk: The block register file.
+ */
+__attribute__((target_clones("avx2", "default")))
+static void prog_pure(const struct fl_prog_t *prog, vec_t *blk)
+{
+	unsigned int i;
+	vec_t *dst, *left, *right;
+	const struct fl_op_t *op, *end;
+
+	for(op = prog->op, end = op + prog->npure; op != end; op++) {
+		dst = blk + op->dst * NVECS;
+		left = blk + op->left * NVECS;
+		right = blk + op->right * NVECS;
+
+		switch(op->code) {
+		case fl_op_mov_v: for(i = 0; i < NVECS; i++) dst[i] = left[i]; break;
+		case fl_op_add_v: for(i = 0; i < NVECS; i++) dst[i] = left[i] + right[i]; break;
+		case fl_op_sub_v: for(i = 0; i < NVECS; i++) dst[i] = left[i] - right[i]; break;
+		case fl_op_mul_v: for(i = 0; i < NVECS; i++) dst[i] = left[i] * right[i]; break;
+		case fl_op_div_v: for(i = 0; i < NVECS; i++) dst[i] = left[i] / right[i]; break;
+		}
+	}
+}
+
+/**
+ * Execute a range of operations on a single sample.
+ *   @op: The first operation.
+ *   @end: The end of the operations.
+ *   @reg: The register file.
+ *   @stride: The distance between consecutive registers.
+ */
+static inline void prog_exec(const struct fl_op_t *op, const struct fl_op_t *end, double *reg, unsigned int stride)
+{
+	for(; op != end; op++) {
+		switch(op->code) {
+		case fl_op_mov_v: reg[op->dst * stride] = reg[op->left * stride]; break;
+		case fl_op_add_v: reg[op->dst * stride] = reg[op->left * stride] + reg[op->right * stride]; break;
+		case fl_op_sub_v: reg[op->dst * stride] = reg[op->left * stride] - reg[op->right * stride]; break;
+		case fl_op_mul_v: reg[op->dst * stride] = reg[op->left * stride] * reg[op->right * stride]; break;
+		case fl_op_div_v: reg[op->dst * stride] = reg[op->left * stride] / reg[op->right * stride]; break;
+		}
+	}
+}
+
+
+/**
+ * Run a program one sample at a time in single precision.
+ *   @prog: The program.
+ *   @in: The input buffer.
+ *   @out: The output buffer.
+ *   @st: The state.
+ *   @len: The number of samples.
+ */
+static void prog_scalarf(const struct fl_prog_t *prog, const float *in, float *out, float *st, unsigned int len)
+{
+	unsigned int i, j;
+	float reg[prog->nregs], *ret;
+
+	memcpy(reg, prog->initf, prog->nregs * sizeof(float));
+	memcpy(reg + prog->in + prog->tmp, st, prog->st * sizeof(float));
+
+	ret = reg + prog->in + prog->tmp + prog->st;
+
+	for(i = 0; i < len; i++) {
+		for(j = 0; j < prog->in; j++)
+			reg[j] = *in++;
+
+		prog_execf(prog->op, prog->op + prog->nops, reg, 1);
+
+		for(j = 0; j < prog->out; j++)
+			*out++ = ret[j];
+	}
+
+	memcpy(st, reg + prog->in + prog->tmp, prog->st * sizeof(float));
+}
+
+/**
+ * Execute the pure operations of a program across a block in single
+ * precision.
+ *   @prog: The program.
+ *   @blk: The block register file.
+ */
+__attribute__((target_clones("avx2", "default")))
+static void prog_puref(const struct fl_prog_t *prog, vecf_t *blk)
+{
+	unsigned int i;
+	vecf_t *dst, *left, *right;
+	const struct fl_op_t *op, *end;
+
+	for(op = prog->op, end = op + prog->npure; op != end; op++) {
+		dst = blk + op->dst * NVECSF;
+		left = blk + op->left * NVECSF;
+		right = blk + op->right * NVECSF;
+
+		switch(op->code) {
+		case fl_op_mov_v: for(i = 0; i < NVECSF; i++) dst[i] = left[i]; break;
+		case fl_op_add_v: for(i = 0; i < NVECSF; i++) dst[i] = left[i] + right[i]; break;
+		case fl_op_sub_v: for(i = 0; i < NVECSF; i++) dst[i] = left[i] - right[i]; break;
+		case fl_op_mul_v: for(i = 0; i < NVECSF; i++) dst[i] = left[i] * right[i]; break;
+		case fl_op_div_v: for(i = 0; i < NVECSF; i++) dst[i] = left[i] / right[i]; break;
+		}
+	}
+}
+
+/**
+ * Execute a range of operations on a single sample in single precision.
+ *   @op: The first operation.
+ *   @end: The end of the operations.
+ *   @reg: The register file.
+ *   @stride: The distance between consecutive registers.
+ */
+static inline void prog_execf(const struct fl_op_t *op, const struct fl_op_t *end, float *reg, unsigned int stride)
+{
+	for(; op != end; op++) {
+		switch(op->code) {
+		case fl_op_mov_v: reg[op->dst * stride] = reg[op->left * stride]; break;
+		case fl_op_add_v: reg[op->dst * stride] = reg[op->left * stride] + reg[op->right * stride]; break;
+		case fl_op_sub_v: reg[op->dst * stride] = reg[op->left * stride] - reg[op->right * stride]; break;
+		case fl_op_mul_v: reg[op->dst * stride] = reg[op->left * stride] * reg[op->right * stride]; break;
+		case fl_op_div_v: reg[op->dst * stride] = reg[op->left * stride] / reg[op->right * stride]; break;
+		}
+	}
+}
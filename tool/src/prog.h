@@ -0,0 +1,63 @@
+#ifndef PROG_H
+#define PROG_H
+
+/*
+ * block definitions
+ */
+#define FL_BLOCK 64
+
+/**
+ * Program opcode enumerator.
+ *   @fl_op_mov_v: Move.
+ *   @fl_op_add_v: Addition.
+ *   @fl_op_sub_v: Subtraction.
+ *   @fl_op_mul_v: Multiplication.
+ *   @fl_op_div_v: Division.
+ */
+enum fl_op_e {
+	fl_op_mov_v,
+	fl_op_add_v,
+	fl_op_sub_v,
+	fl_op_mul_v,
+	fl_op_div_v
+};
+
+/**
+ * Program operation structure.
+ *   @code: The opcode.
+ *   @dst, left, right: The destination, left, and right registers.
+ */
+struct fl_op_t {
+	uint16_t code, dst, left, right;
+};
+
+/**
+ * Program structure.
+ *   @in, tmp, out, st: The number of inputs, temporaries, outputs, and
+ *     states.
+ *   @nregs, nops: The number of registers and operations.
+ *   @npure: The number of leading operations independent of the state.
+ *   @init: The initial register file.
+ *   @initf: The initial register file in single precision.
+ *   @op: The operation array.
+ */
+struct fl_prog_t {
+	unsigned int in, tmp, out, st;
+	unsigned int nregs, nops, npure;
+
+	double *init;
+	float *initf;
+	struct fl_op_t *op;
+};
+
+/*
+ * program declarations
+ */
+struct fl_prog_t *fl_prog_new(const struct fl_func_t *func);
+void fl_prog_delete(struct fl_prog_t *prog);
+
+void fl_prog_eval(const struct fl_prog_t *prog, const double *in, double *out, double *st);
+void fl_prog_run(const struct fl_prog_t *prog, const double *in, double *out, double *st, unsigned int len);
+void fl_prog_runf(const struct fl_prog_t *prog, const float *in, float *out, float *st, unsigned int len);
+
+#endif
@@ -0,0 +1,213 @@
+#include "common.h"
+
+
+/**
+ * Transient candidate structure.
+ *   @mag: The magnitude.
+ *   @idx: The index.
+ */
+struct trans_t {
+	double mag;
+	unsigned int idx;
+};
+
+/*
+ * local declarations
+ */
+static int trans_cmp(const void *left, const void *right);
+static int idx_cmp(const void *left, const void *right);
+
+
+/**
+ * Create a screen for a signal. The screen consists of an interval stage
+ * that statically checks candidates over the input range, a transient
+ * stage that checks state-independent candidates on the samples where the
+ * reference changes the most, and prefix stages of increasing length that
+ * end with the full signal. Stateful candidates cannot skip ahead, so the
+ * transient stage instead runs them from the zero state over a warm-up
+ * that ends just past the largest change before the first prefix bound,
+ * or past the last transient sample before it if later.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The signal length.
+ *   @ntrans: The number of transient samples.
+ *   @prefix: The prefix stage lengths.
+ *   @nprefix: The number of prefix lengths.
+ *   &returns: The screen.
+ */
+struct fl_screen_t *fl_screen_new(const double *in, const double *ref, unsigned int len, unsigned int ntrans, const unsigned int *prefix, unsigned int nprefix)
+{
+	unsigned int i;
+	struct trans_t *trans;
+	struct fl_screen_t *screen;
+
+	if(ntrans > len)
+		ntrans = len;
+
+	screen = malloc(sizeof(struct fl_screen_t));
+	screen->range = fl_ival_range(in, len);
+	screen->idx = malloc(ntrans * sizeof(unsigned int));
+	screen->in = malloc(ntrans * sizeof(double));
+	screen->ref = malloc(ntrans * sizeof(double));
+	screen->ntrans = ntrans;
+
+	screen->bound = malloc((nprefix + 1) * sizeof(unsigned int));
+	screen->nbounds = 0;
+
+	for(i = 0; i < nprefix; i++) {
+		if(prefix[i] >= len)
+			break;
+
+		if((screen->nbounds == 0) || (prefix[i] > screen->bound[screen->nbounds - 1]))
+			screen->bound[screen->nbounds++] = prefix[i];
+	}
+
+	screen->bound[screen->nbounds++] = len;
+
+	trans = malloc(len * sizeof(struct trans_t));
+	for(i = 0; i < len; i++) {
+		trans[i].mag = fabs(ref[i] - ((i > 0) ? ref[i - 1] : 0.0));
+		trans[i].idx = i;
+	}
+
+	qsort(trans, len, sizeof(struct trans_t), trans_cmp);
+
+	for(i = 0; i < ntrans; i++)
+		screen->idx[i] = trans[i].idx;
+
+	screen->warm = 0;
+	for(i = 0; i < len; i++) {
+		if(trans[i].idx < screen->bound[0]) {
+			screen->warm = trans[i].idx + 1;
+			break;
+		}
+	}
+
+	free(trans);
+	qsort(screen->idx, ntrans, sizeof(unsigned int), idx_cmp);
+
+	for(i = 0; i < ntrans; i++) {
+		screen->in[i] = in[screen->idx[i]];
+		screen->ref[i] = ref[screen->idx[i]];
+
+		if((screen->idx[i] < screen->bound[0]) && (screen->idx[i] >= screen->warm))
+			screen->warm = screen->idx[i] + 1;
+	}
+
+	return screen;
+}
+
+/**
+ * Delete a screen.
+ *   @screen: The screen.
+ */
+void fl_screen_delete(struct fl_screen_t *screen)
+{
+	free(screen->idx);
+	free(screen->in);
+	free(screen->ref);
+	free(screen->bound);
+	free(screen);
+}
+
+
+/**
+ * Retrieve the number of stages of a screen, including the interval and
+ * transient stages.
+ *   @screen: The screen.
+ *   &returns: The number of stages.
+ */
+unsigned int fl_screen_nstages(const struct fl_screen_t *screen)
+{
+	return screen->nbounds + 2;
+}
+
+/**
+ * Retrieve the prefix stage covering a sample.
+ *   @screen: The screen.
+ *   @idx: The sample index.
+ *   &returns: The stage.
+ */
+unsigned int fl_screen_stage(const struct fl_screen_t *screen, unsigned int idx)
+{
+	unsigned int i;
+
+	for(i = 0; i < screen->nbounds - 1; i++) {
+		if(idx < screen->bound[i])
+			break;
+	}
+
+	return i + 2;
+}
+
+
+/**
+ * Compute the hash of a screen configuration, covering the interval range,
+ * the transient samples, and the prefix bounds.
+ *   @screen: The screen.
+ *   &returns: The hash.
+ */
+uint64_t fl_screen_hash(const struct fl_screen_t *screen)
+{
+	uint64_t hash = 0;
+
+	mash64buf(&hash, (void *)&screen->range, sizeof(struct fl_ival_t));
+	hash = mash64(hash, screen->ntrans);
+	hash = mash64(hash, screen->warm);
+	mash64buf(&hash, screen->idx, screen->ntrans * sizeof(unsigned int));
+	mash64buf(&hash, screen->in, screen->ntrans * sizeof(double));
+	mash64buf(&hash, screen->ref, screen->ntrans * sizeof(double));
+	hash = mash64(hash, screen->nbounds);
+	mash64buf(&hash, screen->bound, screen->nbounds * sizeof(unsigned int));
+
+	return hash;
+}
+
+/**
+ * Print the number of candidates rejected by each stage.
+ *   @screen: The screen.
+ *   @reject: The per-stage rejection counts.
+ *   @file: The output file.
+ */
+void fl_screen_print(const struct fl_screen_t *screen, const uint64_t *reject, struct io_file_t file)
+{
+	unsigned int i;
+
+	hprintf(file, "interval: %lu rejected\n", reject[0]);
+	hprintf(file, "transient (%u samples, %u warm-up): %lu rejected\n", screen->ntrans, screen->warm, reject[1]);
+
+	for(i = 0; i < screen->nbounds; i++)
+		hprintf(file, "prefix %u: %lu rejected\n", screen->bound[i], reject[i + 2]);
+}
+
+
+/**
+ * Order transients by decreasing magnitude, then by index.
+ *   @left: The left transient.
+ *   @right: The right transient.
+ *   &returns: Their order.
+ */
+static int trans_cmp(const void *left, const void *right)
+{
+	const struct trans_t *a = left, *b = right;
+
+	if(a->mag > b->mag)
+		return -1;
+	else if(a->mag < b->mag)
+		return 1;
+	else
+		return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+/**
+ * Order indices ascending.
+ *   @left: The left index.
+ *   @right: The right index.
+ *   &returns: Their order.
+ */
+static int idx_cmp(const void *left, const void *right)
+{
+	unsigned int a = *(const unsigned int *)left, b = *(const unsigned int *)right;
+
+	return (a > b) - (a < b);
+}
@@ -0,0 +1,39 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+/**
+ * Screen structure.
+ *   @range: The input range for the interval stage.
+ *   @idx: The transient sample indices, ascending.
+ *   @in, ref: The gathered input and reference samples.
+ *   @ntrans: The number of transient samples.
+ *   @warm: The warm-up length that stateful candidates are run over from
+ *     the zero state in the transient stage.
+ *   @bound: The end positions of the prefix stages, the last being the
+ *     signal length.
+ *   @nbounds: The number of prefix stages.
+ */
+struct fl_screen_t {
+	struct fl_ival_t range;
+
+	unsigned int *idx;
+	double *in, *ref;
+	unsigned int ntrans, warm;
+
+	unsigned int *bound;
+	unsigned int nbounds;
+};
+
+/*
+ * screen declarations
+ */
+struct fl_screen_t *fl_screen_new(const double *in, const double *ref, unsigned int len, unsigned int ntrans, const unsigned int *prefix, unsigned int nprefix);
+void fl_screen_delete(struct fl_screen_t *screen);
+
+unsigned int fl_screen_nstages(const struct fl_screen_t *screen);
+unsigned int fl_screen_stage(const struct fl_screen_t *screen, unsigned int idx);
+uint64_t fl_screen_hash(const struct fl_screen_t *screen);
+
+void fl_screen_print(const struct fl_screen_t *screen, const uint64_t *reject, struct io_file_t file);
+
+#endif
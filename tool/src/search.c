@@ -0,0 +1,720 @@
+#include "common.h"
+
+
+/**
+ * Worker structure.
+ *   @search: The search.
+ *   @id: The worker index.
+ *   @rand: The random number generator.
+ *   @arena: The arena.
+ *   @cbuf: The cache append buffer.
+ *   @report: The report callback.
+ *   @arg: The callback argument.
+ *   @thread: The thread.
+ */
+struct worker_t {
+	struct fl_search_t *search;
+	unsigned int id;
+	struct m_rand_t rand;
+	struct fl_arena_t *arena;
+	struct fl_cbuf_t cbuf;
+
+	fl_report_f report;
+	void *arg;
+
+	sys_thread_t thread;
+};
+
+/*
+ * local declarations
+ */
+static void *worker_proc(void *arg);
+static struct fl_inst_t *worker_fetch(void *arg);
+static void worker_report(struct fl_inst_t *inst, double max, unsigned int idx, void *arg);
+static void worker_match(struct worker_t *worker, struct fl_inst_t *inst, double max, unsigned int idx);
+
+static bool search_insert(struct fl_search_t *search, struct fl_inst_t *inst);
+static void search_add(struct fl_search_t *search, struct fl_inst_t *inst);
+static struct fl_inst_t *search_parent(struct fl_search_t *search, struct m_rand_t *rand);
+static void search_compact(struct fl_search_t *search, unsigned int cap);
+static void search_evict(struct fl_search_t *search, struct fl_inst_t *inst);
+static void search_reclaim(struct fl_search_t *search);
+static int search_order(const void *left, const void *right);
+
+
+/**
+ * Compute the population segment of an index.
+ *   @idx: The index.
+ *   @off: Out. The offset within the segment.
+ *   &returns: The segment.
+ */
+static inline unsigned int seg_idx(unsigned int idx, unsigned int *off)
+{
+	unsigned int seg;
+
+	seg = 31 - __builtin_clz(idx / FL_SEGLEN + 1);
+	*off = idx - FL_SEGLEN * ((1u << seg) - 1);
+
+	return seg;
+}
+
+
+/**
+ * Create a search from a generator. The constants and instances of the
+ * generator are copied into the search.
+ *   @gen: The generator.
+ *   @weight: The weights to apply.
+ *   @in: The input signal.
+ *   @ref: The reference signal.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   @screen: Optional. The screen.
+ *   @fit: Optional. The constant fitter applied to every trial.
+ *   &returns: The search.
+ */
+struct fl_search_t *fl_search_new(struct fl_gen_t *gen, const struct fl_weight_t *weight, const double *in, const double *ref, unsigned int len, double tol, const struct fl_screen_t *screen, const struct fl_fit_t *fit)
+{
+	unsigned int i;
+	struct fl_search_t *search;
+
+	search = malloc(sizeof(struct fl_search_t));
+	search->weight = *weight;
+	search->val = malloc(gen->nvals * sizeof(double));
+	search->nvals = gen->nvals;
+	memcpy(search->val, gen->val, gen->nvals * sizeof(double));
+	search->in = in;
+	search->ref = ref;
+	search->len = len;
+	search->tol = tol;
+	search->screen = screen;
+	search->fit = fit;
+	search->reject = NULL;
+	search->prec = fl_prec_f64_v;
+	search->inf = search->reff = NULL;
+	search->cache = NULL;
+	search->sig = 0;
+	search->ntrials = search->limit = search->nmatches = 0;
+	search->lock = sys_mutex_init(0);
+	search->npop = search->cap = 0;
+	search->seq = search->nevict = 0;
+	search->epoch = 0;
+	search->active = NULL;
+	search->nactive = 0;
+	search->retire = malloc(0);
+	search->nretire = 0;
+	search->rand = malloc(0);
+	search->nrands = 0;
+	search->arena = malloc(0);
+	search->narenas = 0;
+
+	for(i = 0; i < FL_SHARDS; i++) {
+		search->shard[i].lock = sys_mutex_init(0);
+		search->shard[i].set = hashset_init((compare_f)fl_inst_cmp, delete_noop);
+		search->shard[i].seen = malloc(0);
+		search->shard[i].nseen = 0;
+	}
+
+	for(i = 0; i < FL_SEGS; i++)
+		search->seg[i] = NULL;
+
+	if(screen != NULL) {
+		search->reject = malloc(fl_screen_nstages(screen) * sizeof(uint64_t));
+		for(i = 0; i < fl_screen_nstages(screen); i++)
+			search->reject[i] = 0;
+	}
+
+	for(i = 0; i < gen->len; i++)
+		fl_search_add(search, fl_inst_new(fl_func_copy(gen->arr[i]->func)));
+
+	return search;
+}
+
+/**
+ * Delete a search.
+ *   @search: The search.
+ */
+void fl_search_delete(struct fl_search_t *search)
+{
+	unsigned int i, j;
+
+	search_reclaim(search);
+
+	for(i = 0; i < search->npop; i++)
+		fl_inst_delete(fl_search_get(search, i));
+
+	for(i = 0; (i < FL_SEGS) && (search->seg[i] != NULL); i++)
+		free(search->seg[i]);
+
+	for(i = 0; i < FL_SHARDS; i++) {
+		for(j = 0; j < search->shard[i].nseen; j++)
+			bloom_destroy(&search->shard[i].seen[j]);
+
+		hashset_destroy(&search->shard[i].set);
+		sys_mutex_destroy(&search->shard[i].lock);
+		free(search->shard[i].seen);
+	}
+
+	for(i = 0; i < search->narenas; i++)
+		fl_arena_delete(search->arena[i]);
+
+	if(search->reject != NULL)
+		free(search->reject);
+
+	sys_mutex_destroy(&search->lock);
+	free(search->retire);
+	free(search->rand);
+	free(search->arena);
+	free(search->val);
+	free(search);
+}
+
+
+/**
+ * Select the scoring precision of a search. The single precision signals
+ * are referenced, not copied. Constants folded by canonicalization and
+ * fitting are still computed in double precision, so only the scoring
+ * itself runs in single precision.
+ *   @search: The search.
+ *   @prec: The precision.
+ *   @in: The single precision input signal.
+ *   @ref: The single precision reference signal.
+ */
+void fl_search_prec(struct fl_search_t *search, enum fl_prec_e prec, const float *in, const float *ref)
+{
+	search->prec = prec;
+	search->inf = in;
+	search->reff = ref;
+}
+
+/**
+ * Attach a persistent fitness cache to a search. Results are only shared
+ * with runs over the same signals, tolerance, precision, screen, and
+ * fitter configuration, so the precision should be selected first.
+ *   @search: The search.
+ *   @cache: The cache, or null to detach.
+ */
+void fl_search_cache(struct fl_search_t *search, struct fl_cache_t *cache)
+{
+	search->cache = cache;
+	search->sig = fl_cache_sig(search->in, search->ref, search->len, search->tol);
+	search->sig = mash64(search->sig, search->prec);
+	search->sig = mash64(search->sig, (search->screen != NULL) ? fl_screen_hash(search->screen) : 0);
+	search->sig = mash64(search->sig, (search->fit != NULL) ? fl_fit_hash(search->fit) : 0);
+}
+
+/**
+ * Cap the population of a search, evicting immediately if needed. While
+ * capped, parents are chosen by tournament and unique trials are copied
+ * out of the worker arenas, so evicting them releases their memory.
+ * Evicted instances are only remembered by hash, so they are still
+ * rejected as duplicates, with a small chance of rejecting a new instance.
+ * The cap should be set before the first run.
+ *   @search: The search.
+ *   @cap: The cap, or zero for unbounded.
+ */
+void fl_search_cap(struct fl_search_t *search, unsigned int cap)
+{
+	sys_mutex_lock(&search->lock);
+
+	search->cap = cap;
+	if((cap > 0) && (search->npop > cap))
+		search_compact(search, cap);
+
+	sys_mutex_unlock(&search->lock);
+}
+
+
+/**
+ * Add a scored instance to the population of a search, unless it is a
+ * duplicate. The search must not be running.
+ *   @search: The search.
+ *   @inst: Consumed. The instance.
+ *   &returns: True if added, false if a duplicate.
+ */
+bool fl_search_add(struct fl_search_t *search, struct fl_inst_t *inst)
+{
+	if(!search_insert(search, inst)) {
+		fl_inst_delete(inst);
+		return false;
+	}
+
+	search_add(search, inst);
+
+	return true;
+}
+
+/**
+ * Add a constant to a search. The search must not be running.
+ *   @search: The search.
+ *   @val: The value.
+ */
+void fl_search_const(struct fl_search_t *search, double val)
+{
+	unsigned int i;
+
+	for(i = 0; i < search->nvals; i++) {
+		if(search->val[i] == val)
+			return;
+	}
+
+	search->val = realloc(search->val, (search->nvals + 1) * sizeof(double));
+	search->val[search->nvals++] = val;
+}
+
+/**
+ * Remove every instance from the population of a search, keeping the
+ * filters of evicted hashes. The search must not be running.
+ *   @search: The search.
+ */
+void fl_search_clear(struct fl_search_t *search)
+{
+	unsigned int i;
+	struct fl_inst_t *inst;
+
+	search_reclaim(search);
+
+	for(i = 0; i < search->npop; i++) {
+		inst = fl_search_get(search, i);
+		hashset_remove(&search->shard[(inst->hash >> 32) % FL_SHARDS].set, inst->hash, inst);
+		fl_inst_delete(inst);
+	}
+
+	search->npop = 0;
+}
+
+
+/**
+ * Run a search across multiple threads. Each worker mutates, deduplicates,
+ * and scores candidates independently, drawing from its own random stream
+ * and allocating from its own arena. The streams and arenas persist across
+ * runs, and are only created the first time a worker index is used.
+ *   @search: The search.
+ *   @nthreads: The number of threads.
+ *   @ntrials: The number of trials.
+ *   @seed: The random seed for new streams.
+ *   @report: The report callback, called serially for every match.
+ *   @arg: The callback argument.
+ */
+void fl_search_run(struct fl_search_t *search, unsigned int nthreads, uint64_t ntrials, uint32_t seed, fl_report_f report, void *arg)
+{
+	unsigned int i;
+	struct worker_t worker[nthreads];
+
+	if(search->npop == 0)
+		fatal("Search requires at least one instance.");
+
+	if(search->cache != NULL)
+		fl_cache_sync(search->cache);
+
+	if(search->nrands < nthreads) {
+		search->rand = realloc(search->rand, nthreads * sizeof(struct m_rand_t));
+		for(i = search->nrands; i < nthreads; i++)
+			search->rand[i] = m_rand_stream(seed, i);
+
+		search->nrands = nthreads;
+	}
+
+	if(search->narenas < nthreads) {
+		search->arena = realloc(search->arena, nthreads * sizeof(void *));
+		for(i = search->narenas; i < nthreads; i++)
+			search->arena[i] = fl_arena_new();
+
+		search->narenas = nthreads;
+	}
+
+	search->limit = search->ntrials + ntrials;
+	search->active = malloc(nthreads * sizeof(uint64_t));
+	search->nactive = nthreads;
+
+	for(i = 0; i < nthreads; i++)
+		search->active[i] = UINT64_MAX;
+
+	for(i = 0; i < nthreads; i++) {
+		worker[i].search = search;
+		worker[i].id = i;
+		worker[i].rand = search->rand[i];
+		worker[i].arena = search->arena[i];
+		worker[i].cbuf.len = 0;
+		worker[i].report = report;
+		worker[i].arg = arg;
+		worker[i].thread = sys_thread_create(0, worker_proc, &worker[i]);
+	}
+
+	for(i = 0; i < nthreads; i++) {
+		sys_thread_join(&worker[i].thread);
+		search->rand[i] = worker[i].rand;
+	}
+
+	free(search->active);
+	search->active = NULL;
+	search->nactive = 0;
+	search_reclaim(search);
+
+	search->ntrials = search->limit;
+}
+
+
+/**
+ * Retrieve an instance from the search population.
+ *   @search: The search.
+ *   @idx: The index.
+ *   &returns: The instance.
+ */
+struct fl_inst_t *fl_search_get(struct fl_search_t *search, unsigned int idx)
+{
+	unsigned int seg, off;
+
+	seg = seg_idx(idx, &off);
+
+	return __atomic_load_n(&search->seg[seg][off], __ATOMIC_RELAXED);
+}
+
+
+/**
+ * Worker thread procedure.
+ *   @arg: The worker.
+ *   &returns: Always null.
+ */
+static void *worker_proc(void *arg)
+{
+	struct worker_t *worker = arg;
+	struct fl_search_t *search = worker->search;
+	unsigned int i;
+	struct fl_batch_t *batch;
+
+	batch = fl_batch_new(FL_LANES, search->in, search->ref, search->len, search->tol, search->screen);
+	fl_batch_prec(batch, search->prec, search->inf, search->reff);
+	fl_batch_run(batch, worker_fetch, worker_report, worker);
+
+	if(search->cache != NULL)
+		fl_cache_flush(search->cache, &worker->cbuf);
+
+	if(search->screen != NULL) {
+		sys_mutex_lock(&search->lock);
+
+		for(i = 0; i < fl_screen_nstages(search->screen); i++)
+			search->reject[i] += batch->reject[i];
+
+		sys_mutex_unlock(&search->lock);
+	}
+
+	fl_batch_delete(batch);
+
+	return NULL;
+}
+
+/**
+ * Fetch the next unique candidate for a worker. Candidates already scored
+ * in the cache are reported immediately instead of being returned. The
+ * worker announces the current epoch while it reads its parent, so an
+ * evicted parent is not released under it.
+ *   @arg: The worker.
+ *   &returns: The instance, or null if the trials are exhausted.
+ */
+static struct fl_inst_t *worker_fetch(void *arg)
+{
+	double max;
+	unsigned int idx;
+	struct fl_mark_t mark;
+	struct fl_inst_t *inst;
+	struct fl_func_t *func;
+	struct worker_t *worker = arg;
+	struct fl_search_t *search = worker->search;
+
+	while(__atomic_fetch_add(&search->ntrials, 1, __ATOMIC_RELAXED) < search->limit) {
+		mark = fl_arena_mark(worker->arena);
+
+		__atomic_store_n(&search->active[worker->id], __atomic_load_n(&search->epoch, __ATOMIC_SEQ_CST), __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		fl_arena_bind(worker->arena);
+		func = search_parent(search, &worker->rand)->func;
+		func = fl_gen_mutate(func, search->val, search->nvals, &search->weight, &worker->rand);
+		fl_arena_bind(NULL);
+
+		__atomic_store_n(&search->active[worker->id], UINT64_MAX, __ATOMIC_RELEASE);
+
+		if(search->fit != NULL) {
+			fl_func_canon(func);
+			fl_fit_run(search->fit, func);
+		}
+
+		inst = fl_inst_new(func);
+		if(search_insert(search, inst)) {
+			if(inst->func != func) {
+				fl_func_delete(func);
+				fl_arena_reset(worker->arena, mark);
+			}
+
+			if((search->cache == NULL) || !fl_cache_get(search->cache, inst->hash, search->sig, &max, &idx))
+				return inst;
+
+			fl_inst_score(inst, max, idx);
+			worker_match(worker, inst, max, idx);
+			search_add(search, inst);
+			continue;
+		}
+
+		fl_inst_delete(inst);
+		fl_arena_reset(worker->arena, mark);
+	}
+
+	return NULL;
+}
+
+/**
+ * Report a scored candidate from a worker, adding it to the population and
+ * recording it in the cache. Only scored instances join the population, so
+ * parents can be ranked without synchronizing on their scores, and matches
+ * are reported before joining, since a capped search may evict them as soon
+ * as they are added.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of accepted samples.
+ *   @arg: The worker.
+ */
+static void worker_report(struct fl_inst_t *inst, double max, unsigned int idx, void *arg)
+{
+	struct worker_t *worker = arg;
+	struct fl_search_t *search = worker->search;
+
+	fl_inst_score(inst, max, idx);
+	worker_match(worker, inst, max, idx);
+
+	if(search->cache != NULL)
+		fl_cache_put(search->cache, &worker->cbuf, inst->hash, search->sig, max, idx);
+
+	search_add(search, inst);
+}
+
+/**
+ * Pass a candidate to the user report if it matches.
+ *   @worker: The worker.
+ *   @inst: The instance.
+ *   @max: The maximum error.
+ *   @idx: The number of accepted samples.
+ */
+static void worker_match(struct worker_t *worker, struct fl_inst_t *inst, double max, unsigned int idx)
+{
+	struct fl_search_t *search = worker->search;
+
+	if(idx < search->len)
+		return;
+
+	sys_mutex_lock(&search->lock);
+	search->nmatches++;
+	worker->report(inst, max, idx, worker->arg);
+	sys_mutex_unlock(&search->lock);
+}
+
+
+/**
+ * Insert an instance into the duplicate detection shards, unless it or an
+ * instance evicted with the same hash is already present. While capped, a
+ * unique instance has its function copied out of the worker arena before
+ * it is published, so other workers never compare against arena memory
+ * that is about to be reset.
+ *   @search: The search.
+ *   @inst: The instance.
+ *   &returns: True if unique, false if a duplicate.
+ */
+static bool search_insert(struct fl_search_t *search, struct fl_inst_t *inst)
+{
+	bool uniq = true;
+	unsigned int i;
+	struct fl_shard_t *shard;
+
+	/* the set probes with the low bits, so shard on the high bits */
+	shard = &search->shard[(inst->hash >> 32) % FL_SHARDS];
+
+	sys_mutex_lock(&shard->lock);
+
+	for(i = 0; (i < shard->nseen) && uniq; i++)
+		uniq = !bloom_query(&shard->seen[i], inst->hash);
+
+	if(uniq)
+		uniq = (hashset_lookup(&shard->set, inst->hash, inst) == NULL);
+
+	if(uniq) {
+		if((search->cap > 0) && (inst->func->arena != NULL))
+			inst->func = fl_func_copy(inst->func);
+
+		hashset_insert(&shard->set, inst->hash, inst);
+	}
+
+	sys_mutex_unlock(&shard->lock);
+
+	return uniq;
+}
+
+/**
+ * Append a scored instance to the population. Segments are never moved or
+ * released, so readers only need the published size. When capped and past
+ * the slack, the population is compacted first.
+ *   @search: The search.
+ *   @inst: The instance.
+ */
+static void search_add(struct fl_search_t *search, struct fl_inst_t *inst)
+{
+	unsigned int seg, off;
+
+	sys_mutex_lock(&search->lock);
+
+	if((search->cap > 0) && (search->npop >= (search->cap + search->cap / FL_GEN_SLACK)))
+		search_compact(search, search->cap);
+
+	inst->seq = search->seq++;
+	seg = seg_idx(search->npop, &off);
+	if(search->seg[seg] == NULL)
+		search->seg[seg] = malloc((FL_SEGLEN << seg) * sizeof(void *));
+
+	__atomic_store_n(&search->seg[seg][off], inst, __ATOMIC_RELAXED);
+	__atomic_store_n(&search->npop, search->npop + 1, __ATOMIC_RELEASE);
+
+	sys_mutex_unlock(&search->lock);
+}
+
+/**
+ * Choose a parent from the population. When capped, the parent is the
+ * better of two random instances.
+ *   @search: The search.
+ *   @rand: The random number generator.
+ *   &returns: The parent.
+ */
+static struct fl_inst_t *search_parent(struct fl_search_t *search, struct m_rand_t *rand)
+{
+	unsigned int n;
+	struct fl_inst_t *parent, *other;
+
+	n = __atomic_load_n(&search->npop, __ATOMIC_ACQUIRE);
+	parent = fl_search_get(search, m_rand_bound(rand, n));
+	if(search->cap > 0) {
+		other = fl_search_get(search, m_rand_bound(rand, n));
+		if(fl_inst_rank(other, parent) < 0)
+			parent = other;
+	}
+
+	return parent;
+}
+
+/**
+ * Evict all but the best ranked instances of the population in place,
+ * keeping the survivors in their original order. Workers that loaded the
+ * previous size may still read a stale slot, so evicted instances are
+ * retired in the current epoch instead of released, and the epoch is
+ * advanced. The population lock must be held.
+ *   @search: The search.
+ *   @cap: The number of instances to keep.
+ */
+static void search_compact(struct fl_search_t *search, unsigned int cap)
+{
+	unsigned int i, n, seg, off;
+	struct fl_inst_t **sort, *cut, *inst;
+
+	sort = malloc(search->npop * sizeof(void *));
+	for(i = 0; i < search->npop; i++)
+		sort[i] = fl_search_get(search, i);
+
+	qsort(sort, search->npop, sizeof(void *), search_order);
+	cut = sort[cap - 1];
+	free(sort);
+
+	for(i = n = 0; i < search->npop; i++) {
+		inst = fl_search_get(search, i);
+		if(search_order(&inst, &cut) > 0) {
+			search_evict(search, inst);
+			continue;
+		}
+
+		seg = seg_idx(n++, &off);
+		__atomic_store_n(&search->seg[seg][off], inst, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&search->npop, n, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&search->epoch, 1, __ATOMIC_SEQ_CST);
+
+	search_reclaim(search);
+}
+
+/**
+ * Evict an instance from the duplicate detection shards, remembering its
+ * hash, and retire it. A new filter twice the size is started whenever the
+ * last one reaches its expected number of insertions.
+ *   @search: The search.
+ *   @inst: The instance.
+ */
+static void search_evict(struct fl_search_t *search, struct fl_inst_t *inst)
+{
+	size_t n;
+	struct bloom_t *last;
+	struct fl_shard_t *shard;
+
+	shard = &search->shard[(inst->hash >> 32) % FL_SHARDS];
+
+	sys_mutex_lock(&shard->lock);
+
+	last = (shard->nseen > 0) ? &shard->seen[shard->nseen - 1] : NULL;
+	n = (last != NULL) ? 2 * (last->mask + 1) / (3 * last->k) : 0;
+
+	if((last == NULL) || (last->count >= n)) {
+		n = (n > 0) ? 2 * n : 4 * (size_t)search->cap / FL_SHARDS + 64;
+		shard->seen = realloc(shard->seen, (shard->nseen + 1) * sizeof(struct bloom_t));
+		shard->seen[shard->nseen++] = bloom_init(n, FL_GEN_PROBES);
+		last = &shard->seen[shard->nseen - 1];
+	}
+
+	bloom_insert(last, inst->hash);
+	hashset_remove(&shard->set, inst->hash, inst);
+
+	sys_mutex_unlock(&shard->lock);
+
+	search->nevict++;
+	search->retire = realloc(search->retire, (search->nretire + 1) * sizeof(struct fl_retire_t));
+	search->retire[search->nretire++] = (struct fl_retire_t){ inst, search->epoch };
+}
+
+/**
+ * Release the retired instances that no worker can still be reading. A
+ * worker that announced a later epoch loaded the population after the
+ * eviction, so only workers announcing the same or an earlier epoch hold
+ * instances back. The population lock must be held while running.
+ *   @search: The search.
+ */
+static void search_reclaim(struct fl_search_t *search)
+{
+	unsigned int i, n;
+	uint64_t epoch, min = UINT64_MAX;
+
+	for(i = 0; i < search->nactive; i++) {
+		epoch = __atomic_load_n(&search->active[i], __ATOMIC_SEQ_CST);
+		if(epoch < min)
+			min = epoch;
+	}
+
+	for(i = n = 0; i < search->nretire; i++) {
+		if(search->retire[i].epoch < min)
+			fl_inst_delete(search->retire[i].inst);
+		else
+			search->retire[n++] = search->retire[i];
+	}
+
+	search->nretire = n;
+}
+
+/**
+ * Order two instance references by rank, breaking ties by sequence.
+ *   @left: The left reference.
+ *   @right: The right reference.
+ *   &returns: Their order.
+ */
+static int search_order(const void *left, const void *right)
+{
+	const struct fl_inst_t *a = *(struct fl_inst_t *const *)left, *b = *(struct fl_inst_t *const *)right;
+	int cmp;
+
+	cmp = fl_inst_rank(a, b);
+	if(cmp != 0)
+		return cmp;
+
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq) ? 1 : 0;
+}
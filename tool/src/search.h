@@ -0,0 +1,130 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+/*
+ * search definitions
+ */
+#define FL_LANES  16
+#define FL_SHARDS 64
+#define FL_SEGS   32
+#define FL_SEGLEN 1024
+
+/**
+ * Shard structure.
+ *   @lock: The lock.
+ *   @set: The instance set.
+ *   @seen: The filters of evicted hashes, each twice the size of the last.
+ *   @nseen: The number of filters.
+ */
+struct fl_shard_t {
+	sys_mutex_t lock;
+	struct hashset_t set;
+	struct bloom_t *seen;
+	unsigned int nseen;
+};
+
+/**
+ * Retired instance structure.
+ *   @inst: The evicted instance.
+ *   @epoch: The epoch it was evicted in.
+ */
+struct fl_retire_t {
+	struct fl_inst_t *inst;
+	uint64_t epoch;
+};
+
+/**
+ * Search structure.
+ *   @weight: The weights.
+ *   @val: Constant value array.
+ *   @nvals: The number of constants.
+ *   @in, ref: The input and reference signals.
+ *   @len: The signal length.
+ *   @tol: The error tolerance.
+ *   @screen: Optional. The screen.
+ *   @fit: Optional. The constant fitter.
+ *   @reject: The per-stage rejection counts when screening.
+ *   @prec: The scoring precision.
+ *   @inf, reff: The single precision input and reference signals.
+ *   @cache: Optional. The persistent fitness cache.
+ *   @sig: The signal fingerprint used with the cache.
+ *   @ntrials, limit: The number of claimed trials and the trial limit.
+ *   @nmatches: The number of matches.
+ *   @shard: The duplicate detection shards.
+ *   @lock: The population and report lock.
+ *   @seg: The population segments.
+ *   @npop: The population size.
+ *   @cap: The population cap, zero if unbounded.
+ *   @seq: The next instance sequence number.
+ *   @nevict: The number of evicted instances.
+ *   @epoch: The eviction epoch.
+ *   @active: The epoch announced by each worker while it reads the
+ *     population, or the maximum when idle.
+ *   @nactive: The number of workers.
+ *   @retire: The evicted instances that workers may still be reading.
+ *   @nretire: The number of retired instances.
+ *   @rand: The random number generators of the workers.
+ *   @nrands: The number of random number generators.
+ *   @arena: The worker arenas.
+ *   @narenas: The number of arenas.
+ */
+struct fl_search_t {
+	struct fl_weight_t weight;
+
+	double *val;
+	unsigned int nvals;
+
+	const double *in, *ref;
+	unsigned int len;
+	double tol;
+
+	const struct fl_screen_t *screen;
+	const struct fl_fit_t *fit;
+	uint64_t *reject;
+
+	enum fl_prec_e prec;
+	const float *inf, *reff;
+
+	struct fl_cache_t *cache;
+	uint64_t sig;
+
+	uint64_t ntrials, limit, nmatches;
+
+	struct fl_shard_t shard[FL_SHARDS];
+
+	sys_mutex_t lock;
+	struct fl_inst_t **seg[FL_SEGS];
+	unsigned int npop, cap;
+	uint64_t seq, nevict;
+
+	uint64_t epoch, *active;
+	unsigned int nactive;
+	struct fl_retire_t *retire;
+	unsigned int nretire;
+
+	struct m_rand_t *rand;
+	unsigned int nrands;
+
+	struct fl_arena_t **arena;
+	unsigned int narenas;
+};
+
+/*
+ * search declarations
+ */
+struct fl_search_t *fl_search_new(struct fl_gen_t *gen, const struct fl_weight_t *weight, const double *in, const double *ref, unsigned int len, double tol, const struct fl_screen_t *screen, const struct fl_fit_t *fit);
+void fl_search_delete(struct fl_search_t *search);
+
+void fl_search_prec(struct fl_search_t *search, enum fl_prec_e prec, const float *in, const float *ref);
+void fl_search_cache(struct fl_search_t *search, struct fl_cache_t *cache);
+void fl_search_cap(struct fl_search_t *search, unsigned int cap);
+
+bool fl_search_add(struct fl_search_t *search, struct fl_inst_t *inst);
+void fl_search_const(struct fl_search_t *search, double val);
+void fl_search_clear(struct fl_search_t *search);
+
+void fl_search_run(struct fl_search_t *search, unsigned int nthreads, uint64_t ntrials, uint32_t seed, fl_report_f report, void *arg);
+
+struct fl_inst_t *fl_search_get(struct fl_search_t *search, unsigned int idx);
+
+#endif
@@ -0,0 +1,274 @@
+#include "common.h"
+
+
+/*
+ * local declarations
+ */
+static void *stream_proc(void *arg);
+
+
+/**
+ * Open a stream over a sound file. Every channel is delivered in aligned
+ * blocks of a fixed length through a ring of slots that a decoder thread
+ * fills ahead of the reader, so memory stays bounded by the ring size
+ * regardless of the file length.
+ *   @stream: Out. The stream.
+ *   @path: The path.
+ *   @blklen: The block length in frames, rounded up to a multiple of the
+ *     program block.
+ *   @nslots: The number of ring slots, at least two.
+ *   &returns: Error.
+ */
+char *fl_stream_open(struct fl_stream_t **stream, const char *path, unsigned int blklen, unsigned int nslots)
+{
+	SF_INFO info;
+	SNDFILE *file;
+	size_t stride;
+	unsigned int i, j;
+	uintptr_t base;
+
+	info.format = 0;
+	file = sf_open(path, SFM_READ, &info);
+	if(file == NULL)
+		return mprintf("Cannot open file '%s'. %s.", path, sf_strerror(NULL));
+
+	blklen = ((blklen + FL_BLOCK - 1) / FL_BLOCK) * FL_BLOCK;
+	if(blklen == 0)
+		blklen = FL_BLOCK;
+
+	if(nslots < 2)
+		nslots = 2;
+
+	*stream = malloc(sizeof(struct fl_stream_t));
+	(*stream)->file = file;
+	(*stream)->nchans = info.channels;
+	(*stream)->blklen = blklen;
+	(*stream)->nslots = nslots;
+	(*stream)->nframes = info.frames;
+
+	stride = (blklen * sizeof(double) + FL_STREAM_ALIGN - 1) & ~(size_t)(FL_STREAM_ALIGN - 1);
+	(*stream)->mem = malloc(nslots * info.channels * stride + FL_STREAM_ALIGN);
+	(*stream)->frame = malloc(blklen * info.channels * sizeof(double));
+	(*stream)->slot = malloc(nslots * sizeof(struct fl_block_t));
+
+	base = ((uintptr_t)(*stream)->mem + FL_STREAM_ALIGN - 1) & ~(uintptr_t)(FL_STREAM_ALIGN - 1);
+
+	for(i = 0; i < nslots; i++) {
+		(*stream)->slot[i].ch = malloc(info.channels * sizeof(double *));
+		(*stream)->slot[i].len = 0;
+		(*stream)->slot[i].pos = 0;
+
+		for(j = 0; j < (unsigned int)info.channels; j++)
+			(*stream)->slot[i].ch[j] = (double *)(base + (i * info.channels + j) * stride);
+	}
+
+	(*stream)->head = (*stream)->count = 0;
+	(*stream)->held = (*stream)->eof = (*stream)->stop = false;
+	(*stream)->lock = sys_mutex_init(0);
+	(*stream)->avail = sys_cond_init(0);
+	(*stream)->space = sys_cond_init(0);
+	(*stream)->thread = sys_thread_create(0, stream_proc, *stream);
+
+	return NULL;
+}
+
+/**
+ * Close a stream, stopping the decoder thread.
+ *   @stream: The stream.
+ */
+void fl_stream_close(struct fl_stream_t *stream)
+{
+	unsigned int i;
+
+	sys_mutex_lock(&stream->lock);
+	stream->stop = true;
+	sys_cond_signal(&stream->space);
+	sys_mutex_unlock(&stream->lock);
+
+	sys_thread_join(&stream->thread);
+
+	sys_cond_destroy(&stream->avail);
+	sys_cond_destroy(&stream->space);
+	sys_mutex_destroy(&stream->lock);
+	sf_close(stream->file);
+
+	for(i = 0; i < stream->nslots; i++)
+		free(stream->slot[i].ch);
+
+	free(stream->slot);
+	free(stream->frame);
+	free(stream->mem);
+	free(stream);
+}
+
+
+/**
+ * Retrieve the next block of a stream, waiting for the decoder if needed.
+ * The block stays valid until the next call, which returns its slot to
+ * the decoder.
+ *   @stream: The stream.
+ *   &returns: The block, or null at the end of the file.
+ */
+const struct fl_block_t *fl_stream_next(struct fl_stream_t *stream)
+{
+	const struct fl_block_t *block = NULL;
+
+	sys_mutex_lock(&stream->lock);
+
+	if(stream->held) {
+		stream->held = false;
+		stream->count--;
+		sys_cond_signal(&stream->space);
+	}
+
+	while((stream->count == 0) && !stream->eof)
+		sys_cond_wait(&stream->avail, &stream->lock);
+
+	if(stream->count > 0) {
+		block = &stream->slot[(stream->head + stream->nslots - stream->count) % stream->nslots];
+		stream->held = true;
+	}
+
+	sys_mutex_unlock(&stream->lock);
+
+	return block;
+}
+
+
+/**
+ * Score programs against the remainder of a stream in a single pass. Each
+ * program maps the input channel to a prediction of the reference,
+ * starting from a zero state, and stops at its first sample outside the
+ * tolerance. The reference is computed block by block, so it can be
+ * another channel or derived from the input, and memory stays bounded
+ * regardless of the file length.
+ *   @stream: The stream.
+ *   @prog: The program array.
+ *   @n: The number of programs.
+ *   @in: The input channel.
+ *   @ref: The reference callback.
+ *   @arg: The callback argument.
+ *   @tol: The error tolerance.
+ *   @max: Out. The maximum error of each program.
+ *   @idx: Out. The number of samples accepted by each program.
+ */
+void fl_stream_score(struct fl_stream_t *stream, struct fl_prog_t **prog, unsigned int n, unsigned int in, fl_ref_f ref, void *arg, double tol, double *max, uint64_t *idx)
+{
+	double out[FL_BLOCK], *want;
+	bool live[n];
+	unsigned int i, j, k, m, nlive = n;
+	double *st[n];
+	const struct fl_block_t *block;
+
+	if(in >= stream->nchans)
+		fatal("Stream channel out of range.");
+
+	for(i = 0; i < n; i++) {
+		if((prog[i]->in != 1) || (prog[i]->out != 1))
+			fatal("Stream programs must have exactly one input and one output.");
+
+		st[i] = malloc(prog[i]->st * sizeof(double));
+		for(j = 0; j < prog[i]->st; j++)
+			st[i][j] = 0.0;
+
+		live[i] = true;
+		max[i] = 0.0;
+		idx[i] = 0;
+	}
+
+	want = malloc(stream->blklen * sizeof(double));
+
+	while((nlive > 0) && ((block = fl_stream_next(stream)) != NULL)) {
+		ref(block, want, arg);
+
+		for(j = 0; j < block->len; j += m) {
+			m = ((block->len - j) < FL_BLOCK) ? (block->len - j) : FL_BLOCK;
+
+			for(i = 0; i < n; i++) {
+				if(!live[i])
+					continue;
+
+				fl_prog_run(prog[i], block->ch[in] + j, out, st[i], m);
+
+				for(k = 0; k < m; k++) {
+					if(isnan(out[k]))
+						break;
+
+					max[i] = fmax(fabs(out[k] - want[j + k]), max[i]);
+					if(max[i] > tol)
+						break;
+				}
+
+				idx[i] += k;
+				if(k < m) {
+					live[i] = false;
+					nlive--;
+				}
+			}
+		}
+	}
+
+	for(i = 0; i < n; i++)
+		free(st[i]);
+
+	free(want);
+}
+
+
+/**
+ * Decoder thread. Blocks are decoded into free slots ahead of the reader
+ * and split into aligned per-channel arrays.
+ *   @arg: The stream.
+ *   &returns: Always null.
+ */
+static void *stream_proc(void *arg)
+{
+	bool stop;
+	sf_count_t i, len;
+	unsigned int j;
+	uint64_t pos = 0;
+	struct fl_block_t *block;
+	struct fl_stream_t *stream = arg;
+
+	while(true) {
+		sys_mutex_lock(&stream->lock);
+
+		while((stream->count == stream->nslots) && !stream->stop)
+			sys_cond_wait(&stream->space, &stream->lock);
+
+		block = &stream->slot[stream->head];
+		stop = stream->stop;
+		sys_mutex_unlock(&stream->lock);
+
+		if(stop)
+			break;
+
+		len = sf_readf_double(stream->file, stream->frame, stream->blklen);
+
+		for(j = 0; j < stream->nchans; j++) {
+			for(i = 0; i < len; i++)
+				block->ch[j][i] = stream->frame[i * stream->nchans + j];
+		}
+
+		block->len = len;
+		block->pos = pos;
+		pos += len;
+
+		sys_mutex_lock(&stream->lock);
+
+		if(len > 0) {
+			stream->head = (stream->head + 1) % stream->nslots;
+			stream->count++;
+		}
+		else
+			stream->eof = true;
+
+		sys_cond_signal(&stream->avail);
+		sys_mutex_unlock(&stream->lock);
+
+		if(len == 0)
+			break;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+/*
+ * stream definitions
+ */
+#define FL_STREAM_ALIGN 64
+
+/**
+ * Stream block structure.
+ *   @ch: The per-channel sample arrays, each aligned.
+ *   @len: The number of frames.
+ *   @pos: The position of the first frame in the file.
+ */
+struct fl_block_t {
+	double **ch;
+	unsigned int len;
+	uint64_t pos;
+};
+
+/**
+ * Compute the reference of a stream block.
+ *   @block: The block.
+ *   @ref: Out. The reference, one sample per frame.
+ *   @arg: The argument.
+ */
+typedef void (*fl_ref_f)(const struct fl_block_t *block, double *ref, void *arg);
+
+/**
+ * Stream structure.
+ *   @file: The sound file.
+ *   @nchans, blklen, nslots: The number of channels, the block length, and
+ *     the number of ring slots.
+ *   @nframes: The number of frames in the file.
+ *   @mem: The sample memory.
+ *   @frame: The interleaved decode buffer.
+ *   @slot: The ring of blocks.
+ *   @head, count: The next slot to fill and the number of filled slots.
+ *   @held, eof, stop: The block held by the reader, end of file, and stop
+ *     flags.
+ *   @lock: The lock.
+ *   @avail, space: The filled and free slot conditions.
+ *   @thread: The decoder thread.
+ */
+struct fl_stream_t {
+	SNDFILE *file;
+	unsigned int nchans, blklen, nslots;
+	uint64_t nframes;
+
+	void *mem;
+	double *frame;
+	struct fl_block_t *slot;
+	unsigned int head, count;
+	bool held, eof, stop;
+
+	sys_mutex_t lock;
+	sys_cond_t avail, space;
+	sys_thread_t thread;
+};
+
+/*
+ * stream declarations
+ */
+char *fl_stream_open(struct fl_stream_t **stream, const char *path, unsigned int blklen, unsigned int nslots);
+void fl_stream_close(struct fl_stream_t *stream);
+
+const struct fl_block_t *fl_stream_next(struct fl_stream_t *stream);
+
+void fl_stream_score(struct fl_stream_t *stream, struct fl_prog_t **prog, unsigned int n, unsigned int in, fl_ref_f ref, void *arg, double tol, double *max, uint64_t *idx);
+
+#endif